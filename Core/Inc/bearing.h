@@ -0,0 +1,23 @@
+#ifndef BEARING_H
+#define BEARING_H
+
+#include "main.h"
+#include <stdint.h>
+
+// Binary angle units: 65536 = 360 degrees, eye 0 at 0, counter-clockwise
+#define BEARING_EYES 14
+#define BEARING_DEG(bam) (((uint32_t)(bam) * 360U) >> 16)
+
+typedef struct {
+  uint16_t angle;      // 加權向量和的方向 (BAM16)
+  uint32_t magnitude;  // 向量長度, same scale as the eye values
+  uint32_t cycles;     // DWT cycles spent in Bearing_Compute
+  uint32_t maxCycles;  // worst case since Bearing_Init
+} Bearing;
+
+void Bearing_Init(void);
+void Bearing_Compute(const uint16_t *eyes, Bearing *result);
+uint16_t Bearing_Atan2(int32_t y, int32_t x, uint32_t *magnitude);
+HAL_StatusTypeDef Bearing_Report(const Bearing *bearing);
+
+#endif  // BEARING_H
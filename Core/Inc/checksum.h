@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdint.h>
+
+#define CRC16_INIT 0xFFFF
+#define CRC8_INIT 0xFF
+#define CRC8_XOROUT 0xFF
+
+// CRC-16/CCITT-FALSE (poly 0x1021), pass CRC16_INIT to start a new block
+uint16_t Checksum_CRC16(uint16_t crc, const uint8_t *data, uint16_t size);
+
+// CRC-8/SAE-J1850 (poly 0x1D), start with CRC8_INIT and XOR the result with CRC8_XOROUT
+uint8_t Checksum_CRC8(uint8_t crc, const uint8_t *data, uint16_t size);
+
+#endif  // CHECKSUM_H
@@ -5,8 +5,23 @@
 #include <stdio.h>
 #include <stdint.h>
 
+// TX ring buffer size in bytes (must be a power of two)
+#ifndef DATA_UART_TX_BUFFER_SIZE
+#define DATA_UART_TX_BUFFER_SIZE 512
+#endif
+
 void dataUart_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef dataUart_Write(const uint8_t *data, uint16_t size);
+uint16_t dataUart_TxPending(void);
+uint16_t dataUart_TxSpace(void);
+uint32_t dataUart_GetDroppedBytes(void);
+uint32_t dataUart_GetBusyUs(void);
+HAL_StatusTypeDef dataUart_StartRx(void);
+int dataUart_ReadByte(void);
+void dataUart_RxCallback(void);  // weak, called from the RX interrupt
+void dataUart_TxCallback(void);  // weak, called from the TX interrupt
+
 HAL_StatusTypeDef ParseAndDisplayIRData(uint8_t *data, uint16_t size);
 HAL_StatusTypeDef DisplayRawHexData(uint8_t *data, uint16_t size);
 
-#endif // DATA_UART_H
\ No newline at end of file
+#endif // DATA_UART_H
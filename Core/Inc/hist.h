@@ -0,0 +1,37 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include "main.h"
+#include <stdint.h>
+
+// Log2 histogram shared by the profiler (cycles) and the frame latency (us)
+#define HIST_BUCKETS 16
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t hist[HIST_BUCKETS];
+} Hist_Stats;
+
+// Bucket 0 = under 2^(shift+1), bucket b = [2^(b+shift), 2^(b+shift+1)),
+// the last bucket also takes everything above; caller serializes
+void Hist_Add(Hist_Stats *h, uint32_t value, uint8_t shift);
+
+// Streams one "<prefix> <name> n= min= mean= max=<unit> h=..." line per
+// Hist_Poll, only when the whole line fits in the TX ring
+typedef struct {
+  const char *prefix;
+  const char *unit;
+  const char *const *names;
+  const Hist_Stats *stats;  // table of count entries
+  uint8_t count;
+  int8_t next;              // 下一個要輸出的項目, -1 = 沒有要求
+} Hist_Report;
+
+void Hist_RequestReport(Hist_Report *report);
+uint8_t Hist_ReportPending(const Hist_Report *report);
+void Hist_Poll(Hist_Report *report);
+
+#endif  // HIST_H
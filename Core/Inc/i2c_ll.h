@@ -0,0 +1,38 @@
+#ifndef I2C_LL_H
+#define I2C_LL_H
+
+#include "i2c.h"
+#include "profile.h"
+#include <stdint.h>
+
+// 1 = IR reads bypass the HAL I2C state machine (see i2c_ll.c)
+#ifndef IR_USE_LL_I2C
+#define IR_USE_LL_I2C 0
+#endif
+
+// Whether the bus interrupts go to the LL handlers. Profiling builds on the
+// HAL path also route a transfer I2C_DriverReport started through the LL
+#if IR_USE_LL_I2C
+#define I2C_LL_OWNS(hi2c) 1
+#elif PROFILE_ENABLED
+#define I2C_LL_OWNS(hi2c) I2C_LL_IsBusy(hi2c)
+#else
+#define I2C_LL_OWNS(hi2c) 0
+#endif
+
+// Fixed-length DMA master read for the IR slaves only. The handle is kept
+// for identity and for init/recovery through the HAL; completion and errors
+// are reported through HAL_I2C_MasterRxCpltCallback / HAL_I2C_ErrorCallback
+// with hi2c->ErrorCode set like the HAL does.
+HAL_StatusTypeDef I2C_LL_Read(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t *data, uint16_t size);
+// Same, after writing one register byte (repeated START, the LL counterpart of the Seq transmit/receive pair)
+HAL_StatusTypeDef I2C_LL_MemRead(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint8_t *data,
+                                 uint16_t size);
+void I2C_LL_Abort(I2C_HandleTypeDef *hi2c);  // drop a transfer without callbacks
+uint8_t I2C_LL_IsBusy(I2C_HandleTypeDef *hi2c);
+
+void I2C_LL_EV_IRQHandler(I2C_HandleTypeDef *hi2c);
+void I2C_LL_ER_IRQHandler(I2C_HandleTypeDef *hi2c);
+void I2C_LL_DMA_IRQHandler(I2C_HandleTypeDef *hi2c);
+
+#endif  // I2C_LL_H
@@ -2,7 +2,38 @@
 #define I2C_MASTER_H
 
 #include "i2c.h"
+#include "profile.h"
+
+// 7-bit addresses outside this range are reserved and never probed
+#define I2C_SCAN_FIRST 0x08
+#define I2C_SCAN_LAST 0x77
+#define I2C_PROBE_TIMEOUT_MS 2
+#define I2C_COMPARE_MAX 64           // I2C_DriverReport read size limit
+#define I2C_COMPARE_TIMEOUT_US 5000
+
+// Background scan, one address per I2C_ScanStep; 0 in next means idle
+typedef struct {
+  I2C_HandleTypeDef *hi2c;
+  uint32_t found[4];  // bit per 7-bit address
+  uint8_t next;       // next address to probe
+  uint8_t count;
+  uint8_t stuck;      // aborted, the bus was held busy
+} I2C_ScanState;
+
+void I2C_ScanStart(I2C_ScanState *scan, I2C_HandleTypeDef *hi2c);
+uint8_t I2C_ScanBusy(const I2C_ScanState *scan);
+void I2C_ScanStep(I2C_ScanState *scan);
+uint8_t I2C_ScanFound(const I2C_ScanState *scan, uint8_t addr);
+HAL_StatusTypeDef I2C_ScanReport(const I2C_ScanState *scan);
 
 uint16_t I2C_Scan(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef I2C_BusRecover(I2C_HandleTypeDef *hi2c);
+
+#if PROFILE_ENABLED
+// Blocking: the same read once through the HAL and once through i2c_ll.c,
+// reports the CPU cycles of each start call and of its interrupts. The
+// caller holds the bus (IR_ClaimBus)
+HAL_StatusTypeDef I2C_DriverReport(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint16_t size);
+#endif
 
 #endif  // I2C_MASTER_H
\ No newline at end of file
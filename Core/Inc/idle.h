@@ -0,0 +1,20 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "main.h"
+#include <stdint.h>
+
+// 1 = also gate the flash interface clock while asleep (RCC FLITFEN); code
+// runs from flash again as soon as an interrupt wakes the core
+#ifndef IDLE_LOW_POWER
+#define IDLE_LOW_POWER 0
+#endif
+
+void Idle_Init(void);
+// Sleep until the next interrupt; only from the thread-mode idle loop
+void Idle_Sleep(void);
+// Busy share of the window since the last report, in 0.1 %
+uint16_t Idle_GetLoad(void);
+HAL_StatusTypeDef Idle_Report(void);
+
+#endif  // IDLE_H
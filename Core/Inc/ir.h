@@ -3,6 +3,7 @@
 
 #include "led.h"
 #include "i2c.h"
+#include "bearing.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -10,21 +11,170 @@
 #define IR_BUFFER_SIZE 16 // 8 * 2 bytes
 #define EYE_NUM 7
 
+// Checked slave frame: payload, a sequence byte, then CRC-8 over payload + seq.
+// Queue slots always have room for it, the read length follows IR_SetFrameCheck
+#define IR_FRAME_SEQ IR_BUFFER_SIZE
+#define IR_FRAME_CRC (IR_BUFFER_SIZE + 1)
+#define IR_FRAME_SIZE (IR_BUFFER_SIZE + 2)
+
+// Slave firmware sends the trailer (needs a matching slave build)
+#ifndef IR_USE_FRAME_CHECK
+#define IR_USE_FRAME_CHECK 0
+#endif
+
+// Region of interest: between full sweeps read only Vref and the eyes within
+// ±span of the last maxEye. Writing IR_REG_WINDOW(first, count) selects what
+// the slave sends next: Vref, count eyes from first, then the trailer if on
+#ifndef IR_ROI_SPAN
+#define IR_ROI_SPAN 0          // 0 = always full sweeps
+#endif
+#define IR_ROI_MAX_SPAN 3      // 7 eyes, a window then stays contiguous on each slave
+#define IR_ROI_FULL_EVERY 8    // every 8th sweep reads all eyes again
+#define IR_REG_WINDOW(first, count) (0x80U | ((first) << 3) | (count))
+
+// Batch: the slave buffers its last K sweeps and IR_REG_BATCH(K) returns them
+// oldest first, each a full frame (with trailer if on), in one transaction
+#ifndef IR_BATCH_SAMPLES
+#define IR_BATCH_SAMPLES 1     // 1 = one sample per read
+#endif
+#define IR_BATCH_MAX 4
+#define IR_REG_BATCH(count) (0x40U | (count))
+
+// Slave 送的 Vref 是它量到的內部參考電壓 (VREFINT) 原始值, 12-bit ADC
+#define IR_ADC_FULL_SCALE 4095
+#define IR_VREFINT_MV 1200
+#define SLAVES_NO 2
+#define SLAVE_1_ADDR (0x30 << 1)  // HAL (shifted) addresses
+#define SLAVE_2_ADDR (0x31 << 1)
+
+_Static_assert(SLAVES_NO * EYE_NUM == BEARING_EYES, "bearing table must cover every eye");
+
+// Frame queue depth (power of two, one slot is always the DMA target)
+#ifndef IR_QUEUE_SIZE
+#define IR_QUEUE_SIZE 8
+#endif
+
+// 匯流排錯誤復原: 進行中的 sweep 超過此時間視為卡住
+#define IR_I2C_TIMEOUT_MS 5
+#define IR_BACKOFF_MIN_MS 1
+#define IR_BACKOFF_MAX_MS 64
+
+// Raw ADC count above which the strongest eye means the ball is seen (LED solid)
+#ifndef IR_BALL_THRESHOLD
+#define IR_BALL_THRESHOLD 200
+#endif
+
+// Hot-plug: a slave missing this many reads in a row leaves the sweep and is
+// only probed every IR_HOTPLUG_PROBE_MS until it answers again
+#define IR_HOTPLUG_MISSES 3
+#define IR_HOTPLUG_PROBE_MS 500
+
+// Data-ready mode: an open frame waits this long for the slowest slave
+#define IR_DRDY_TIMEOUT_MS 20
+
 typedef enum { SLAVE_1 = 0, SLAVE_2 } Slave_ID;
-extern uint8_t ProcessBuffer[2][IR_BUFFER_SIZE];
+
+// What starts a read: TIM2 (Sampler) sweeps, or each slave's data-ready line
+typedef enum { IR_TRIGGER_TIMER = 0, IR_TRIGGER_DATA_READY } IR_Trigger;
+
+// Error blinked on the LED while a bus needs recovery, cleared by the next full sweep
+typedef enum {
+  IR_FAULT_NONE = 0,
+  IR_FAULT_BUS_ERROR,    // 1 blink: BERR
+  IR_FAULT_ARBITRATION,  // 2 blinks: ARLO
+  IR_FAULT_DMA,          // 3 blinks
+  IR_FAULT_TIMEOUT,      // 4 blinks: BUSY stuck or no callback
+} IR_Fault;
+
+typedef struct {
+  uint32_t timestamp;  // Timebase_Us() at sweep start, back-dated for batch samples
+  uint32_t seq;        // sweep number, gaps mean overwritten frames
+  uint32_t dmaStart;   // Timebase_Us() when the first read was started
+  uint32_t dmaDone;    // Timebase_Us() when the last slave completed
+  uint8_t present;     // bit per slave in data[], missing slaves are zeroed
+  uint16_t eyeMask;    // bit per eye read in this sweep, the rest are zero
+  uint8_t data[SLAVES_NO][IR_FRAME_SIZE];
+} IR_Frame;
+
+typedef struct {
+  uint32_t produced;     // frames queued by the ISR
+  uint32_t consumed;     // frames released by main
+  uint32_t overwritten;  // complete sweeps lost because the queue was full
+} IR_QueueStats;
+
+typedef struct {
+  uint32_t nack;        // AF, slave absent or busy
+  uint32_t busError;    // BERR, misplaced START/STOP
+  uint32_t arbitration; // ARLO
+  uint32_t overrun;     // OVR
+  uint32_t dma;         // DMA transfer error
+  uint32_t timeout;     // stuck BUSY flag or a read that never completed
+  uint32_t recoveries;  // bus clear + re-init of this slave's bus
+  uint32_t detached;    // dropped out of the sweep after IR_HOTPLUG_MISSES
+  uint32_t attached;    // answered a probe and was re-admitted
+  uint32_t crc;         // checked frame failed its CRC-8, dropped
+  uint32_t duplicate;   // same sequence number as the last frame, dropped
+  uint32_t gap;         // sequence numbers skipped between accepted frames
+} IR_ErrorStats;
+
+// Consumer-owned frame, re-pointed by IR_AcquireFrame
+extern uint8_t (*ProcessBuffer)[IR_FRAME_SIZE];
 
 extern uint8_t maxEye;
 extern uint16_t maxValue;
+extern Bearing ballBearing;
 
+// Pass the same handle twice to put both slaves on one bus
 void IR_Init(I2C_HandleTypeDef *hi2c1, I2C_HandleTypeDef *hi2c2);
 
 HAL_StatusTypeDef IR_ReadData(Slave_ID slaves_id);
 uint8_t IR_SaveData(Slave_ID slave_id, uint8_t *data, uint16_t size);
 uint8_t IR_IsDataReady(Slave_ID slave_id);
 void IR_ClearDataReady(Slave_ID slave_id);
+uint32_t IR_GetFrameCount(Slave_ID slave_id);
+
+void IR_SetTrigger(IR_Trigger trigger);
+// Read and validate the seq + CRC trailer; the slaves must send it
+void IR_SetFrameCheck(uint8_t enable);
+// Partial reads around maxEye, 0 = off (up to IR_ROI_MAX_SPAN)
+void IR_SetRoi(uint8_t span);
+// K samples per read, taken period_us apart by the slave; ROI is off while K > 1
+void IR_SetBatch(uint8_t samples, uint32_t period_us);
+HAL_StatusTypeDef IR_StartSweep(void);
+void IR_SlaveReady(Slave_ID slave_id);
+uint8_t IR_IsFrameReady(void);
+uint8_t IR_QueueDepth(void);
+uint8_t IR_AcquireFrame(void);
+const IR_Frame *IR_CurrentFrame(void);
+uint16_t IR_CopyPayload(uint8_t *out);
+void IR_GetQueueStats(IR_QueueStats *stats);
+uint32_t IR_GetSweepCount(void);
+
+// Main loop: detects stuck reads and runs bus recovery outside interrupts
+void IR_Service(void);
+// 1 while IR_Service has a deadline to watch: reads on the bus, a data-ready
+// frame still open, or a recovery queued
+uint8_t IR_ServiceDue(void);
+void IR_GetErrorStats(Slave_ID slave_id, IR_ErrorStats *stats);
+uint8_t IR_GetPresentMask(void);
+
+// Keep sweeps off the buses while something else (the scanner) uses them;
+// IR_ClaimBus fails while a sweep is running
+uint8_t IR_ClaimBus(void);
+void IR_ReleaseBus(void);
+HAL_StatusTypeDef IR_ErrorReport(void);
+
+// Weak hooks, called from the I2C interrupts: a frame was queued, or a bus
+// error wants IR_Service to run soon; and from the sweep trigger (TIM2 or
+// data-ready): a sweep went on the bus, IR_ServiceDue until it ends
+void IR_FrameReadyCallback(void);
+void IR_BusErrorCallback(void);
+void IR_SweepStartCallback(void);
 
 uint16_t combine_data(uint8_t msb, uint8_t lsb);
-float IR_ADC_to_Voltage(uint16_t adc_value, float vref);
+uint16_t IR_ADC_to_mV(uint16_t adc_value, uint16_t vref_raw);
+uint16_t IR_Vdda_mV(uint16_t vref_raw);
+void IR_NormalizeFrame(uint8_t (*frame)[IR_FRAME_SIZE], uint16_t *eyes_mv);
 
 void updateValues();
 
@@ -0,0 +1,73 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "main.h"
+#include <stdint.h>
+
+/*
+ * Interrupt priorities, NVIC_PRIORITYGROUP_4 (set in HAL_Init): 16 preemption
+ * levels, no sub-priority. A lower number pre-empts a higher one, handlers on
+ * the same level never nest. The CubeMX-generated inits (i2c.c, dma.c,
+ * usart.c) carry literal copies from ir_master.ioc; the MspInit USER CODE
+ * sections set these defines again, so they win even after a regeneration.
+ * Keep the .ioc in step anyway (I2C 0, DMA 1, USART2 3, SysTick 14, PendSV 15).
+ */
+#define IRQ_PRIO_BUS 0         // I2C1/I2C2 EV+ER: SB/ADDR/BTF must be served within a byte
+#define IRQ_PRIO_DMA 1         // DMA1 ch4-7 (I2C): completion chains the next slave
+#define IRQ_PRIO_ACQUIRE 2     // TIM2 sample trigger, EXTI data-ready
+#define IRQ_PRIO_TELEMETRY 3   // USART2 TX/RX
+#define IRQ_PRIO_HOUSEKEEPING TICK_INT_PRIORITY  // SysTick, 14
+#define IRQ_PRIO_TASKS 15      // PendSV, the scheduler tasks
+
+#if IRQ_PRIO_HOUSEKEEPING <= IRQ_PRIO_TELEMETRY || IRQ_PRIO_HOUSEKEEPING >= IRQ_PRIO_TASKS
+#error "TICK_INT_PRIORITY must sit between telemetry and the scheduler"
+#endif
+
+// Latency probe: a TIM3 update at each level in turn, CNT at handler entry is
+// the time the interrupt waited. Release (no DEBUG) builds leave it out
+#ifndef IRQ_PROBE_ENABLED
+#ifdef DEBUG
+#define IRQ_PROBE_ENABLED 1
+#else
+#define IRQ_PROBE_ENABLED 0
+#endif
+#endif
+
+#define IRQ_PROBE_TIM TIM3
+#define IRQ_PROBE_IRQn TIM3_IRQn
+#define IRQ_PROBE_MHZ 8          // 125 ns per count
+#define IRQ_PROBE_PERIOD_US 7919  // prime, drifts across the 1 ms tick and sample period
+
+typedef enum {
+  IRQ_LEVEL_BUS,
+  IRQ_LEVEL_DMA,
+  IRQ_LEVEL_ACQUIRE,
+  IRQ_LEVEL_TELEMETRY,
+  IRQ_LEVEL_HOUSEKEEPING,
+  IRQ_LEVEL_TASKS,
+  IRQ_LEVELS
+} Irq_Level;
+
+typedef struct {
+  uint32_t count;
+  uint32_t maxTicks;  // IRQ_PROBE_MHZ counts
+  uint64_t sumTicks;
+} Irq_LatencyStats;
+
+#if IRQ_PROBE_ENABLED
+
+void Irq_ProbeInit(void);
+void Irq_ProbeHandler(void);  // TIM3_IRQHandler
+void Irq_GetLatency(Irq_Level level, Irq_LatencyStats *stats);
+void Irq_ResetLatency(void);
+HAL_StatusTypeDef Irq_Report(void);
+
+#else
+
+#define Irq_ProbeInit() ((void)0)
+#define Irq_ResetLatency() ((void)0)
+#define Irq_Report() ((void)0)
+
+#endif  // IRQ_PROBE_ENABLED
+
+#endif  // IRQ_H
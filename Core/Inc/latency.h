@@ -0,0 +1,33 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "main.h"
+#include "ir.h"
+#include "hist.h"
+#include "timebase.h"
+#include <stdint.h>
+
+// Frame age histograms, bucket b = [2^b, 2^(b+1)) us, bucket 0 also holds 0 us
+#define LATENCY_BUCKETS HIST_BUCKETS
+
+typedef enum {
+  LATENCY_DMA,      // first read started -> last slave complete
+  LATENCY_PROCESS,  // complete -> processed (queue wait included)
+  LATENCY_UART,     // processed -> handed to the TX ring
+  LATENCY_TOTAL,    // first read started -> handed to the TX ring
+  LATENCY_STAGES
+} Latency_Stage;
+
+typedef Hist_Stats Latency_Stats;  // in us
+
+// µs clock, keeps counting while the core sleeps in WFI (CYCCNT stops)
+static inline uint32_t Latency_Now(void) { return Timebase_Us(); }
+
+void Latency_Record(const IR_Frame *frame, uint32_t processed, uint32_t sent);
+void Latency_Reset(void);
+const Latency_Stats *Latency_Get(Latency_Stage stage);
+void Latency_RequestReport(void);
+void Latency_Poll(void);
+uint8_t Latency_ReportPending(void);
+
+#endif  // LATENCY_H
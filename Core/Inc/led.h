@@ -4,9 +4,27 @@
 #include "gpio.h"
 #include <stdint.h>
 
+typedef enum {
+  LED_PATTERN_OFF = 0,
+  LED_PATTERN_HEARTBEAT,  // double blink every second
+  LED_PATTERN_FRAME,      // short pulse per LED_FrameEvent()
+  LED_PATTERN_ERROR,      // N blinks then a pause, N = error code
+  LED_PATTERN_BALL,       // solid on while the ball is seen
+} LED_Pattern;
+
+#define LED_ERROR_MAX_CODE 9  // more blinks than this cannot be counted by eye
+#define LED_IDLE_MS 1000      // FRAME/BALL without a frame this long: heartbeat
+
 void LED_On(void);
 void LED_Off(void);
 void LED_Toggle(void);
 void LED_Flash(uint32_t delay_ms, uint8_t times);
 
-#endif  // LED_H
\ No newline at end of file
+// Non-blocking pattern engine, LED_Tick() runs from SysTick every 1 ms.
+// A non-zero error code overrides the pattern until it is set back to 0
+void LED_SetPattern(LED_Pattern pattern);
+void LED_SetErrorCode(uint8_t code);
+void LED_FrameEvent(void);
+void LED_Tick(void);
+
+#endif  // LED_H
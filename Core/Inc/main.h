@@ -59,7 +59,16 @@ void Error_Handler(void);
 /* Private defines -----------------------------------------------------------*/
 
 /* USER CODE BEGIN Private defines */
-
+// Optional slave data-ready lines (rising edge = new ADC sweep on the slave)
+#ifndef IR_USE_DATA_READY
+#define IR_USE_DATA_READY 0
+#endif
+#define IR_DRDY1_Pin GPIO_PIN_0
+#define IR_DRDY1_GPIO_Port GPIOA
+#define IR_DRDY1_EXTI_IRQn EXTI0_IRQn
+#define IR_DRDY2_Pin GPIO_PIN_1
+#define IR_DRDY2_GPIO_Port GPIOA
+#define IR_DRDY2_EXTI_IRQn EXTI1_IRQn
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
@@ -0,0 +1,41 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "main.h"
+#include "ir.h"
+#include <stdint.h>
+
+/*
+ * Three overlapping stages per frame:
+ *   acquire  sweep DMA, started by TIM2 or data-ready, queued by the I2C ISR
+ *   process  updateValues + telemetry formatting in the main loop
+ *   emit     UART IT drain of the TX ring
+ * Frame N+1 is on the bus while N is processed and N-1 is still going out,
+ * so the rate is set by the slowest stage. Occupancy = busy time / window,
+ * both on the µs clock so time asleep in WFI is still counted.
+ */
+typedef enum { PIPE_ACQUIRE, PIPE_PROCESS, PIPE_EMIT, PIPE_STAGES } Pipe_Stage;
+
+// TX ring space one frame's output may need (ASCII line is the longest)
+#define PIPE_EMIT_RESERVE 128
+
+typedef struct {
+  uint32_t frames;                // frames through the process stage
+  uint32_t stalls;                // passes a ready frame waited for TX ring space
+  uint32_t busyUs[PIPE_STAGES];
+  uint32_t windowUs;
+  uint8_t queueMax;               // deepest IR queue (acquire -> process)
+  uint16_t txMax;                 // fullest TX ring (process -> emit)
+} Pipeline_Stats;
+
+void Pipeline_Init(void);
+// Back-pressure: take the next frame only if emit can hold its output
+uint8_t Pipeline_CanProcess(void);
+// From the TX interrupt: a stalled frame can go now, no polling needed
+uint8_t Pipeline_Resume(void);
+void Pipeline_Processed(const IR_Frame *frame, uint32_t start, uint32_t end);
+void Pipeline_GetStats(Pipeline_Stats *stats);
+// Occupancy of the window since the last report, then start a new window
+HAL_StatusTypeDef Pipeline_Report(void);
+
+#endif  // PIPELINE_H
@@ -0,0 +1,59 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "main.h"
+#include "hist.h"
+#include <stdint.h>
+
+// DWT CYCCNT 區段量測, Release (no DEBUG) 時整個模組編譯成空
+#ifndef PROFILE_ENABLED
+#ifdef DEBUG
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ENABLED 0
+#endif
+#endif
+
+#define PROFILE_BUCKETS HIST_BUCKETS
+#define PROFILE_BUCKET_SHIFT 4  // bucket 0 = under 32 cycles, bucket b = [2^(b+4), 2^(b+5))
+
+typedef enum {
+  PROFILE_I2C_START,     // IR_ReadData, HAL or LL read start
+  PROFILE_I2C_IRQ,       // every I2C EV/ER and RX DMA interrupt of a read
+  PROFILE_I2C_CALLBACK,
+  PROFILE_UPDATE_VALUES,
+  PROFILE_UART_FORMAT,
+  PROFILE_LED_TICK,
+  PROFILE_REGIONS
+} Profile_Region;
+
+typedef Hist_Stats Profile_Stats;  // in cycles
+
+// Always available, the bearing timing needs CYCCNT even without profiling
+void Profile_EnableCycleCounter(void);
+
+#if PROFILE_ENABLED
+
+#define PROFILE_BEGIN(region) uint32_t profileStart_##region = DWT->CYCCNT
+#define PROFILE_END(region) Profile_Record((region), DWT->CYCCNT - profileStart_##region)
+
+void Profile_Record(Profile_Region region, uint32_t cycles);
+void Profile_Reset(void);
+const Profile_Stats *Profile_Get(Profile_Region region);
+void Profile_RequestDump(void);
+void Profile_Poll(void);
+uint8_t Profile_DumpPending(void);
+
+#else
+
+#define PROFILE_BEGIN(region) ((void)0)
+#define PROFILE_END(region) ((void)0)
+
+#define Profile_Reset() ((void)0)
+#define Profile_RequestDump() ((void)0)
+#define Profile_Poll() ((void)0)
+#define Profile_DumpPending() 0
+
+#endif  // PROFILE_ENABLED
+
+#endif  // PROFILE_H
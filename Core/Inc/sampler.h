@@ -0,0 +1,30 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "ir.h"
+#include <stdint.h>
+
+// TIM2 counts at 1 MHz, one update event per sample period
+#define SAMPLER_TIM TIM2
+#define SAMPLER_MIN_HZ 20
+#define SAMPLER_MAX_HZ 1000
+
+typedef struct {
+  uint16_t targetHz;     // 設定的取樣率
+  uint16_t achievedHz;   // 上一秒實際完成的完整 frame 數
+  uint16_t jitterMinUs;  // 上一秒 update event 到開始讀取的最小延遲
+  uint16_t jitterMaxUs;  // 上一秒 update event 到開始讀取的最大延遲
+  uint32_t triggers;     // total timer periods
+  uint32_t skipped;      // periods where the previous sweep was still running
+} Sampler_Stats;
+
+void Sampler_Init(uint16_t rate_hz);
+void Sampler_SetRate(uint16_t rate_hz);
+void Sampler_Start(void);
+void Sampler_Stop(void);
+void Sampler_GetStats(Sampler_Stats *stats);
+HAL_StatusTypeDef Sampler_Report(void);
+
+void Sampler_IRQHandler(void);
+
+#endif  // SAMPLER_H
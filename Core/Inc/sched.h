@@ -0,0 +1,46 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "main.h"
+#include <stdint.h>
+
+/*
+ * Run-to-completion tasks dispatched from PendSV (lowest priority, so every
+ * peripheral ISR still pre-empts them). ISRs post events, the highest ready
+ * priority runs one event to completion, then the bitmap is checked again.
+ * One task per priority, 0 = highest.
+ */
+#define SCHED_MAX_TASKS 8
+#define SCHED_QUEUE_SIZE 8  // events per task, power of two
+#define SCHED_TICK_US 1000  // Sched_Tick period (SysTick)
+
+typedef enum {
+  SCHED_EV_FRAME_READY = 1,  // IR frame published
+  SCHED_EV_TICK,             // task tick period elapsed (Timebase_Us deadline)
+  SCHED_EV_UART_RX,          // command byte received
+  SCHED_EV_I2C_ERROR,        // bus error, recovery wanted
+  SCHED_EV_UART_TX,          // TX ring has room again for held-back output
+} Sched_Event;
+
+typedef void (*Sched_Handler)(Sched_Event event);
+
+typedef struct {
+  uint32_t runs;
+  uint32_t wcet;     // longest single run in CYCCNT cycles
+  uint32_t dropped;  // posts lost to a full queue
+} Sched_TaskStats;
+
+void Sched_Init(void);
+// tick_ms = 0: no SCHED_EV_TICK for this task
+void Sched_AddTask(uint8_t prio, const char *name, Sched_Handler handler, uint16_t tick_ms);
+// ISR-safe; a new period starts counting now, the same period keeps its phase
+void Sched_SetTick(uint8_t prio, uint16_t tick_ms);
+// ISR-safe; an event already waiting in the task's queue is not queued twice
+uint8_t Sched_Post(uint8_t prio, Sched_Event event);
+void Sched_Tick(void);      // SysTick, every 1 ms
+void Sched_Dispatch(void);  // PendSV_Handler
+void Sched_GetStats(uint8_t prio, Sched_TaskStats *stats);
+void Sched_ResetStats(void);
+HAL_StatusTypeDef Sched_Report(void);
+
+#endif  // SCHED_H
@@ -0,0 +1,37 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "data_uart.h"
+#include "ir.h"
+#include <stdint.h>
+
+typedef enum { TELEMETRY_ASCII = 0, TELEMETRY_BINARY } Telemetry_Mode;
+
+// Build-time default, override with -DTELEMETRY_DEFAULT_MODE=TELEMETRY_BINARY
+#ifndef TELEMETRY_DEFAULT_MODE
+#define TELEMETRY_DEFAULT_MODE TELEMETRY_ASCII
+#endif
+
+/*
+ * Binary frame (little-endian), COBS encoded and terminated by 0x00:
+ *   [0]      frame type (TELEMETRY_TYPE_IR)
+ *   [1]      IR_Frame.seq, low 8 bits; a gap means frames were dropped
+ *   [2..5]   IR_Frame.timestamp, sweep start in Timebase_Us() us
+ *   [6]      maxEye
+ *   [7..8]   maxValue
+ *   [9..]    raw ProcessBuffer words
+ *   [last 2] CRC-16/CCITT-FALSE over everything above
+ */
+#define TELEMETRY_TYPE_IR 0x01
+#define TELEMETRY_HEADER_SIZE 9
+#define TELEMETRY_MAX_PAYLOAD 32
+
+void Telemetry_SetMode(Telemetry_Mode mode);
+Telemetry_Mode Telemetry_GetMode(void);
+
+// frame supplies seq and timestamp, data is its payload (IR_CopyPayload)
+HAL_StatusTypeDef Telemetry_SendIRFrame(const IR_Frame *frame, uint8_t *data, uint16_t size, uint8_t eye,
+                                        uint16_t value);
+uint16_t Telemetry_COBSEncode(const uint8_t *src, uint16_t size, uint8_t *dst);
+
+#endif  // TELEMETRY_H
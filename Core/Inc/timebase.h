@@ -0,0 +1,30 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "main.h"
+#include <stdint.h>
+
+/*
+ * 32-bit free-running microsecond clock, wraps every 71.6 min. TIM4 counts at
+ * 1 MHz and its update (TRGO) clocks TIM1 through ITR3, so TIM1:TIM4 is one
+ * 32-bit counter. No interrupt, keeps counting in Sleep, readable from any
+ * priority. HAL_GetTick() is derived from it (timebase.c); SysTick stays the
+ * 1 ms housekeeping interrupt.
+ */
+#define TIMEBASE_TIM_LO TIM4
+#define TIMEBASE_TIM_HI TIM1
+
+void Timebase_Init(void);  // from HAL_InitTick, restarts at 0
+
+// A carry between the two reads of the high half shows up as a change; TIM1
+// takes ~2 timer clocks to follow TIM4's wrap, less than one APB read
+static inline uint32_t Timebase_Us(void) {
+  uint32_t hi, lo;
+  do {
+    hi = TIMEBASE_TIM_HI->CNT;
+    lo = TIMEBASE_TIM_LO->CNT;
+  } while (hi != TIMEBASE_TIM_HI->CNT);
+  return (hi << 16) | lo;
+}
+
+#endif  // TIMEBASE_H
@@ -0,0 +1,89 @@
+#include "bearing.h"
+#include "data_uart.h"
+#include "profile.h"
+
+#define CORDIC_STEPS 16
+#define CORDIC_GAIN_Q15 19898  // 1 / 1.64676 (product of the CORDIC stretch)
+
+// Q15 cos/sin of eye i at i * 360/14 degrees, round(32767 * cos(2*pi*i/14))
+static const int16_t eyeCos[BEARING_EYES] = {
+  32767, 29522, 20430, 7291, -7291, -20430, -29522,
+  -32767, -29522, -20430, -7291, 7291, 20430, 29522,
+};
+static const int16_t eyeSin[BEARING_EYES] = {
+  0, 14217, 25618, 31945, 31945, 25618, 14217,
+  0, -14217, -25618, -31945, -31945, -25618, -14217,
+};
+
+// atan(2^-i) in BAM16
+static const uint16_t cordicAtan[CORDIC_STEPS] = {
+  8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1, 1, 0,
+};
+
+void Bearing_Init(void) {
+  // DWT 週期計數器, 用來量測每個 frame 的計算時間
+  Profile_EnableCycleCounter();
+}
+
+// CORDIC vectoring: fixed 16 steps, shifts and adds only
+uint16_t Bearing_Atan2(int32_t y, int32_t x, uint32_t *magnitude) {
+  uint16_t angle = 0;
+
+  // 先轉到右半平面
+  if (x < 0) {
+    int32_t t = x;
+    if (y >= 0) {
+      x = y;
+      y = -t;
+      angle = 0x4000;
+    } else {
+      x = -y;
+      y = t;
+      angle = 0xC000;
+    }
+  }
+
+  for (int i = 0; i < CORDIC_STEPS; i++) {
+    int32_t dx = x >> i;
+    int32_t dy = y >> i;
+    if (y > 0) {
+      x += dy;
+      y -= dx;
+      angle += cordicAtan[i];
+    } else {
+      x -= dy;
+      y += dx;
+      angle -= cordicAtan[i];
+    }
+  }
+
+  if (magnitude != NULL) {
+    *magnitude = (uint32_t)(((uint64_t)x * CORDIC_GAIN_Q15) >> 15);
+  }
+  return angle;
+}
+
+void Bearing_Compute(const uint16_t *eyes, Bearing *result) {
+  uint32_t start = DWT->CYCCNT;
+  int32_t x = 0;
+  int32_t y = 0;
+
+  // Each term fits in 16 bits after >> 15, 14 of them fit easily in int32
+  for (int i = 0; i < BEARING_EYES; i++) {
+    x += ((int32_t)eyes[i] * eyeCos[i]) >> 15;
+    y += ((int32_t)eyes[i] * eyeSin[i]) >> 15;
+  }
+
+  result->angle = Bearing_Atan2(y, x, &result->magnitude);
+
+  result->cycles = DWT->CYCCNT - start;
+  if (result->cycles > result->maxCycles) result->maxCycles = result->cycles;
+}
+
+HAL_StatusTypeDef Bearing_Report(const Bearing *bearing) {
+  char buffer[80];
+  int len = snprintf(buffer, sizeof(buffer), "Bearing: %lu deg, mag %lu, %lu cycles (max %lu)\r\n",
+                     (unsigned long)BEARING_DEG(bearing->angle), (unsigned long)bearing->magnitude,
+                     (unsigned long)bearing->cycles, (unsigned long)bearing->maxCycles);
+  return dataUart_Write((uint8_t *)buffer, len);
+}
@@ -0,0 +1,28 @@
+#include "checksum.h"
+
+// 4-bit 查表, 32 bytes of flash instead of 512
+static const uint16_t crc16Nibble[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t Checksum_CRC16(uint16_t crc, const uint8_t *data, uint16_t size) {
+  for (uint16_t i = 0; i < size; i++) {
+    crc = (crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+static const uint8_t crc8Nibble[16] = {
+  0x00, 0x1D, 0x3A, 0x27, 0x74, 0x69, 0x4E, 0x53,
+  0xE8, 0xF5, 0xD2, 0xCF, 0x9C, 0x81, 0xA6, 0xBB,
+};
+
+uint8_t Checksum_CRC8(uint8_t crc, const uint8_t *data, uint16_t size) {
+  for (uint16_t i = 0; i < size; i++) {
+    crc = (uint8_t)(crc << 4) ^ crc8Nibble[(crc >> 4) ^ (data[i] >> 4)];
+    crc = (uint8_t)(crc << 4) ^ crc8Nibble[(crc >> 4) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
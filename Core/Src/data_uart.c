@@ -1,9 +1,138 @@
 #include "data_uart.h"
+#include "timebase.h"
+
+#define TX_MASK (DATA_UART_TX_BUFFER_SIZE - 1)
+
+#if (DATA_UART_TX_BUFFER_SIZE & TX_MASK) != 0
+#error "DATA_UART_TX_BUFFER_SIZE must be a power of two"
+#endif
 
 static UART_HandleTypeDef *dataUart_huart;
 
+// 環形緩衝區: main 寫入 head, ISR 推進 tail
+static uint8_t txBuffer[DATA_UART_TX_BUFFER_SIZE];
+static volatile uint16_t txHead = 0;
+static volatile uint16_t txTail = 0;
+static volatile uint16_t txChunk = 0;       // 目前 IT 傳送中的位元組數
+static volatile uint32_t txDropped = 0;     // 溢位丟棄的位元組數
+static volatile uint32_t txBusyUs = 0;      // 有 chunk 在傳送的累計 µs
+static uint32_t txChunkStart = 0;
+
+// 指令接收: 每次收 1 byte, ISR 放進小環形緩衝區
+#define RX_SIZE 16
+static uint8_t rxByte;
+static uint8_t rxBuffer[RX_SIZE];
+static volatile uint8_t rxHead = 0;
+static volatile uint8_t rxTail = 0;
+
+// Start the next contiguous chunk; caller must hold off the USART IRQ
+static void dataUart_StartTx(void) {
+  if (txChunk != 0 || txHead == txTail) return;
+
+  uint16_t tail = txTail;
+  uint16_t len = (txHead > tail) ? (txHead - tail) : (DATA_UART_TX_BUFFER_SIZE - tail);
+  if (HAL_UART_Transmit_IT(dataUart_huart, &txBuffer[tail], len) == HAL_OK) {
+    txChunk = len;
+    txChunkStart = Timebase_Us();
+  }
+}
+
 void dataUart_Init(UART_HandleTypeDef *huart) {
   dataUart_huart = huart;
+  txHead = 0;
+  txTail = 0;
+  txChunk = 0;
+  txDropped = 0;
+  rxHead = 0;
+  rxTail = 0;
+}
+
+// Start receiving single-byte commands in the background
+HAL_StatusTypeDef dataUart_StartRx(void) {
+  if (dataUart_huart == NULL) return HAL_ERROR;
+  return HAL_UART_Receive_IT(dataUart_huart, &rxByte, 1);
+}
+
+// Next received byte, or -1 if none
+int dataUart_ReadByte(void) {
+  if (rxHead == rxTail) return -1;
+  uint8_t byte = rxBuffer[rxTail];
+  rxTail = (rxTail + 1) % RX_SIZE;
+  return byte;
+}
+
+// Queue bytes for background transmission; never blocks
+HAL_StatusTypeDef dataUart_Write(const uint8_t *data, uint16_t size) {
+  if (dataUart_huart == NULL || data == NULL) return HAL_ERROR;
+
+  uint16_t head = txHead;
+  uint16_t used = (head - txTail) & TX_MASK;
+  uint16_t space = TX_MASK - used;
+
+  // Whole messages only, a half-written line is worse than a missing one
+  if (size > space) {
+    txDropped += size;
+    return HAL_BUSY;
+  }
+
+  for (uint16_t i = 0; i < size; i++) {
+    txBuffer[head] = data[i];
+    head = (head + 1) & TX_MASK;
+  }
+  __DMB();
+  txHead = head;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  dataUart_StartTx();
+  __set_PRIMASK(primask);
+
+  return HAL_OK;
+}
+
+uint16_t dataUart_TxPending(void) { return (txHead - txTail) & TX_MASK; }
+
+uint16_t dataUart_TxSpace(void) { return TX_MASK - dataUart_TxPending(); }
+
+uint32_t dataUart_GetDroppedBytes(void) { return txDropped; }
+
+// µs spent with a transfer in flight, wraps; take differences
+uint32_t dataUart_GetBusyUs(void) { return txBusyUs; }
+
+/* UART TX complete callback */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart != dataUart_huart) return;
+
+  txTail = (txTail + txChunk) & TX_MASK;
+  txChunk = 0;
+  txBusyUs += Timebase_Us() - txChunkStart;
+  dataUart_StartTx();
+  dataUart_TxCallback();
+}
+
+/* UART RX complete callback */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart != dataUart_huart) return;
+
+  uint8_t next = (rxHead + 1) % RX_SIZE;
+  if (next != rxTail) {
+    rxBuffer[rxHead] = rxByte;
+    rxHead = next;
+  }
+  HAL_UART_Receive_IT(huart, &rxByte, 1);
+  dataUart_RxCallback();
+}
+
+// Weak hook, a byte is waiting for dataUart_ReadByte
+__attribute__((weak)) void dataUart_RxCallback(void) {}
+
+// Weak hook, a chunk went out and freed TX ring space
+__attribute__((weak)) void dataUart_TxCallback(void) {}
+
+/* UART error callback: an overrun aborts the receive, re-arm it */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  if (huart != dataUart_huart) return;
+  HAL_UART_Receive_IT(huart, &rxByte, 1);
 }
 
 // Function to parse and display IR data as decimal values
@@ -24,7 +153,7 @@ HAL_StatusTypeDef ParseAndDisplayIRData(uint8_t *data, uint16_t size) {
   
   buffer[pos++] = '\r';
   buffer[pos++] = '\n';
-  return HAL_UART_Transmit(dataUart_huart, (uint8_t*)buffer, pos, HAL_MAX_DELAY);
+  return dataUart_Write((uint8_t*)buffer, pos);
 }
 
 // Function to display raw hex data
@@ -44,5 +173,5 @@ HAL_StatusTypeDef DisplayRawHexData(uint8_t *data, uint16_t size) {
   
   buffer[bufferPos++] = '\r';
   buffer[bufferPos++] = '\n';  
-  return HAL_UART_Transmit(dataUart_huart, (uint8_t*)buffer, bufferPos, HAL_MAX_DELAY);
+  return dataUart_Write((uint8_t*)buffer, bufferPos);
 }
\ No newline at end of file
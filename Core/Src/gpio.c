@@ -22,7 +22,7 @@
 #include "gpio.h"
 
 /* USER CODE BEGIN 0 */
-
+#include "irq.h"
 /* USER CODE END 0 */
 
 /*----------------------------------------------------------------------------*/
@@ -63,5 +63,21 @@ void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 2 */
+/* Slave data-ready inputs PA0/PA1, only used when IR_USE_DATA_READY is set */
+void MX_GPIO_DataReady_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
 
+  /*Configure GPIO pins : IR_DRDY1_Pin IR_DRDY2_Pin */
+  GPIO_InitStruct.Pin = IR_DRDY1_Pin|IR_DRDY2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(IR_DRDY1_GPIO_Port, &GPIO_InitStruct);
+
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(IR_DRDY1_EXTI_IRQn, IRQ_PRIO_ACQUIRE, 0);
+  HAL_NVIC_EnableIRQ(IR_DRDY1_EXTI_IRQn);
+  HAL_NVIC_SetPriority(IR_DRDY2_EXTI_IRQn, IRQ_PRIO_ACQUIRE, 0);
+  HAL_NVIC_EnableIRQ(IR_DRDY2_EXTI_IRQn);
+}
 /* USER CODE END 2 */
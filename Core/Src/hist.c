@@ -0,0 +1,48 @@
+#include "hist.h"
+#include "data_uart.h"
+
+void Hist_Add(Hist_Stats *h, uint32_t value, uint8_t shift) {
+  uint8_t bucket = 0;
+  if (value != 0) {
+    int msb = 31 - __builtin_clz(value);
+    if (msb > shift) bucket = (msb - shift >= HIST_BUCKETS) ? HIST_BUCKETS - 1 : msb - shift;
+  }
+
+  if (h->count == 0 || value < h->min) h->min = value;
+  if (value > h->max) h->max = value;
+  h->sum += value;
+  h->count++;
+  h->hist[bucket]++;
+}
+
+void Hist_RequestReport(Hist_Report *report) { report->next = 0; }
+
+uint8_t Hist_ReportPending(const Hist_Report *report) { return report->next >= 0; }
+
+void Hist_Poll(Hist_Report *report) {
+  if (report->next < 0) return;
+
+  // The profiler records from ISRs too, take the entry in one piece
+  Hist_Stats s;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  s = report->stats[report->next];
+  __set_PRIMASK(primask);
+
+  char buffer[200];
+  uint32_t mean = s.count ? (uint32_t)(s.sum / s.count) : 0;
+  int pos = snprintf(buffer, sizeof(buffer), "%s %s n=%lu min=%lu mean=%lu max=%lu%s h=",
+                     report->prefix, report->names[report->next], (unsigned long)s.count,
+                     (unsigned long)s.min, (unsigned long)mean, (unsigned long)s.max, report->unit);
+  for (int i = 0; i < HIST_BUCKETS && pos < (int)sizeof(buffer) - 14; i++) {
+    pos += snprintf(&buffer[pos], sizeof(buffer) - pos, i ? ",%lu" : "%lu",
+                    (unsigned long)s.hist[i]);
+  }
+  buffer[pos++] = '\r';
+  buffer[pos++] = '\n';
+
+  if (pos > dataUart_TxSpace()) return;
+  dataUart_Write((uint8_t *)buffer, pos);
+
+  if (++report->next >= report->count) report->next = -1;
+}
@@ -0,0 +1,227 @@
+#include "i2c_ll.h"
+#include "timebase.h"
+#include "stm32f1xx_ll_i2c.h"
+#include "stm32f1xx_ll_dma.h"
+
+// STOP 之後 BUSY 旗標最多要等多久 (us), 400 kHz 下一個 STOP 約 2.5 us
+#define I2C_LL_BUSY_WAIT_US 50
+
+typedef struct {
+  I2C_HandleTypeDef *hi2c;
+  uint32_t dmaChannel;   // LL_DMA_CHANNEL_x of the I2C RX request
+  uint16_t size;
+  int16_t reg;           // register byte written before the read, -1 = plain read
+  uint8_t writing;       // register phase, the repeated START follows its BTF
+  volatile uint8_t busy;
+} I2C_LL_Bus;
+
+// I2C1_RX 固定在 DMA1 Ch7, I2C2_RX 在 DMA1 Ch5
+static I2C_LL_Bus buses[2];
+
+static I2C_LL_Bus *I2C_LL_Find(I2C_HandleTypeDef *hi2c) {
+  int idx;
+  uint32_t channel;
+
+  if (hi2c->Instance == I2C1) {
+    idx = 0;
+    channel = LL_DMA_CHANNEL_7;
+  } else if (hi2c->Instance == I2C2) {
+    idx = 1;
+    channel = LL_DMA_CHANNEL_5;
+  } else {
+    return NULL;
+  }
+  buses[idx].hi2c = hi2c;
+  buses[idx].dmaChannel = channel;
+  return &buses[idx];
+}
+
+// DMA1 ISR/IFCR pack 4 flags per channel, channel 1 at bit 0
+static inline uint32_t I2C_LL_DmaFlags(uint32_t channel, uint32_t flag) {
+  return flag << ((channel - 1) * 4);
+}
+
+// Back to idle: DMA and IRQs off, ACK/POS/LAST cleared for the next read
+static void I2C_LL_Finish(I2C_LL_Bus *bus) {
+  I2C_TypeDef *i2c = bus->hi2c->Instance;
+
+  LL_DMA_DisableChannel(DMA1, bus->dmaChannel);
+  LL_DMA_DisableIT_TC(DMA1, bus->dmaChannel);
+  LL_DMA_DisableIT_TE(DMA1, bus->dmaChannel);
+  DMA1->IFCR = I2C_LL_DmaFlags(bus->dmaChannel, DMA_IFCR_CGIF1);
+
+  LL_I2C_DisableIT_EVT(i2c);
+  LL_I2C_DisableIT_ERR(i2c);
+  LL_I2C_DisableDMAReq_RX(i2c);
+  LL_I2C_DisableLastDMA(i2c);
+  LL_I2C_DisableBitPOS(i2c);
+  LL_I2C_AcknowledgeNextData(i2c, LL_I2C_NACK);
+  bus->busy = 0;
+}
+
+static HAL_StatusTypeDef I2C_LL_Start(I2C_HandleTypeDef *hi2c, uint16_t devAddr, int16_t reg,
+                                      uint8_t *data, uint16_t size) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  if (bus == NULL || data == NULL || size == 0) return HAL_ERROR;
+  if (bus->busy) return HAL_BUSY;
+
+  I2C_TypeDef *i2c = hi2c->Instance;
+
+  // A chained read starts right after the previous STOP, give it time to go out
+  uint32_t start = Timebase_Us();
+  while (LL_I2C_IsActiveFlag_BUSY(i2c)) {
+    if (Timebase_Us() - start > I2C_LL_BUSY_WAIT_US) {
+      hi2c->ErrorCode = HAL_I2C_ERROR_TIMEOUT;  // SDA held low, needs a bus clear
+      return HAL_BUSY;
+    }
+  }
+
+  bus->busy = 1;
+  bus->size = size;
+  bus->reg = reg;
+  bus->writing = reg >= 0;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->Devaddress = devAddr;
+
+  // Channel direction/increment/width stay as HAL_DMA_Init left them in MspInit
+  LL_DMA_DisableChannel(DMA1, bus->dmaChannel);
+  DMA1->IFCR = I2C_LL_DmaFlags(bus->dmaChannel, DMA_IFCR_CGIF1);
+  LL_DMA_SetPeriphAddress(DMA1, bus->dmaChannel, LL_I2C_DMA_GetRegAddr(i2c));
+  LL_DMA_SetMemoryAddress(DMA1, bus->dmaChannel, (uint32_t)data);
+  LL_DMA_SetDataLength(DMA1, bus->dmaChannel, size);
+  LL_DMA_DisableIT_HT(DMA1, bus->dmaChannel);
+  LL_DMA_EnableIT_TC(DMA1, bus->dmaChannel);
+  LL_DMA_EnableIT_TE(DMA1, bus->dmaChannel);
+  LL_DMA_EnableChannel(DMA1, bus->dmaChannel);
+
+  LL_I2C_DisableBitPOS(i2c);
+  LL_I2C_AcknowledgeNextData(i2c, LL_I2C_ACK);
+  LL_I2C_EnableDMAReq_RX(i2c);
+  LL_I2C_EnableIT_EVT(i2c);
+  LL_I2C_EnableIT_ERR(i2c);
+  LL_I2C_GenerateStartCondition(i2c);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef I2C_LL_Read(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t *data, uint16_t size) {
+  return I2C_LL_Start(hi2c, devAddr, -1, data, size);
+}
+
+HAL_StatusTypeDef I2C_LL_MemRead(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint8_t reg, uint8_t *data,
+                                 uint16_t size) {
+  return I2C_LL_Start(hi2c, devAddr, reg, data, size);
+}
+
+void I2C_LL_Abort(I2C_HandleTypeDef *hi2c) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  if (bus != NULL) I2C_LL_Finish(bus);
+}
+
+uint8_t I2C_LL_IsBusy(I2C_HandleTypeDef *hi2c) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  return bus != NULL && bus->busy;
+}
+
+// EV5 (SB) sends the address, EV6 (ADDR) arms the end of transfer; a register
+// read first writes the register byte and restarts on its EV8_2 (BTF)
+void I2C_LL_EV_IRQHandler(I2C_HandleTypeDef *hi2c) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  I2C_TypeDef *i2c = hi2c->Instance;
+
+  if (LL_I2C_IsActiveFlag_SB(i2c)) {
+    LL_I2C_TransmitData8(i2c, (uint8_t)(hi2c->Devaddress | (bus->writing ? 0U : 1U)));
+    return;
+  }
+
+  if (bus->writing) {
+    if (LL_I2C_IsActiveFlag_ADDR(i2c)) {
+      LL_I2C_ClearFlag_ADDR(i2c);
+      LL_I2C_TransmitData8(i2c, (uint8_t)bus->reg);
+    } else if (LL_I2C_IsActiveFlag_BTF(i2c)) {
+      // BTF stays set until the START is out, the SB branch picks it up from there
+      bus->writing = 0;
+      LL_I2C_GenerateStartCondition(i2c);
+    }
+    return;
+  }
+
+  if (!LL_I2C_IsActiveFlag_ADDR(i2c)) return;
+
+  // F103 errata: the ACK/POS/STOP programming around the ADDR clear must not
+  // be delayed by another interrupt, or the NACK lands on the wrong byte
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (bus->size == 1) {
+    // N=1: NACK the only byte, STOP goes out from the DMA TC
+    LL_I2C_AcknowledgeNextData(i2c, LL_I2C_NACK);
+    LL_I2C_ClearFlag_ADDR(i2c);
+  } else if (bus->size == 2) {
+    // N=2: POS moves the NACK to the second byte, ACK off after ADDR
+    LL_I2C_EnableBitPOS(i2c);
+    LL_I2C_ClearFlag_ADDR(i2c);
+    LL_I2C_AcknowledgeNextData(i2c, LL_I2C_NACK);
+    LL_I2C_EnableLastDMA(i2c);
+  } else {
+    // N>2: LAST makes the peripheral NACK the byte that ends the DMA
+    LL_I2C_EnableLastDMA(i2c);
+    LL_I2C_ClearFlag_ADDR(i2c);
+  }
+  __set_PRIMASK(primask);
+
+  // Everything after the address is DMA, only errors need the I2C IRQ now
+  LL_I2C_DisableIT_EVT(i2c);
+}
+
+void I2C_LL_ER_IRQHandler(I2C_HandleTypeDef *hi2c) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  I2C_TypeDef *i2c = hi2c->Instance;
+  uint32_t error = HAL_I2C_ERROR_NONE;
+
+  if (LL_I2C_IsActiveFlag_BERR(i2c)) {
+    error |= HAL_I2C_ERROR_BERR;
+    LL_I2C_ClearFlag_BERR(i2c);
+  }
+  if (LL_I2C_IsActiveFlag_ARLO(i2c)) {
+    error |= HAL_I2C_ERROR_ARLO;
+    LL_I2C_ClearFlag_ARLO(i2c);
+  }
+  if (LL_I2C_IsActiveFlag_AF(i2c)) {
+    error |= HAL_I2C_ERROR_AF;
+    LL_I2C_ClearFlag_AF(i2c);
+    LL_I2C_GenerateStopCondition(i2c);  // release the bus after the NACK
+  }
+  if (LL_I2C_IsActiveFlag_OVR(i2c)) {
+    error |= HAL_I2C_ERROR_OVR;
+    LL_I2C_ClearFlag_OVR(i2c);
+  }
+  if (error == HAL_I2C_ERROR_NONE || !bus->busy) return;
+
+  I2C_LL_Finish(bus);
+  hi2c->ErrorCode = error;
+  HAL_I2C_ErrorCallback(hi2c);
+}
+
+// DMA TC: the last byte is in memory and already NACKed, send the STOP
+void I2C_LL_DMA_IRQHandler(I2C_HandleTypeDef *hi2c) {
+  I2C_LL_Bus *bus = I2C_LL_Find(hi2c);
+  uint32_t flags = DMA1->ISR;
+
+  if (!bus->busy) {
+    DMA1->IFCR = I2C_LL_DmaFlags(bus->dmaChannel, DMA_IFCR_CGIF1);
+    return;
+  }
+
+  if (flags & I2C_LL_DmaFlags(bus->dmaChannel, DMA_ISR_TEIF1)) {
+    LL_I2C_GenerateStopCondition(hi2c->Instance);
+    I2C_LL_Finish(bus);
+    hi2c->ErrorCode = HAL_I2C_ERROR_DMA;
+    HAL_I2C_ErrorCallback(hi2c);
+    return;
+  }
+
+  if (flags & I2C_LL_DmaFlags(bus->dmaChannel, DMA_ISR_TCIF1)) {
+    LL_I2C_GenerateStopCondition(hi2c->Instance);
+    I2C_LL_Finish(bus);
+    HAL_I2C_MasterRxCpltCallback(hi2c);
+  }
+}
@@ -1,13 +1,169 @@
 #include "i2c_master.h"
+#include "i2c_ll.h"
+#include "data_uart.h"
+#include "timebase.h"
+#include <string.h>
 
-// 掃描 I2C 区域尋找可用設備
+void I2C_ScanStart(I2C_ScanState *scan, I2C_HandleTypeDef *hi2c) {
+  memset(scan, 0, sizeof(*scan));
+  scan->hi2c = hi2c;
+  scan->next = I2C_SCAN_FIRST;
+}
+
+uint8_t I2C_ScanBusy(const I2C_ScanState *scan) { return scan->next != 0; }
+
+// One address, a single trial with a short timeout (NACK returns in ~25 us)
+void I2C_ScanStep(I2C_ScanState *scan) {
+  if (scan->next == 0) return;
+  if (HAL_I2C_GetState(scan->hi2c) != HAL_I2C_STATE_READY) return;
+
+  // HAL_I2C_IsDeviceReady would wait 25 ms on a held bus for every address
+  if (scan->hi2c->Instance->SR2 & I2C_SR2_BUSY) {
+    scan->stuck = 1;
+    scan->next = 0;
+    return;
+  }
+
+  uint8_t addr = scan->next;
+  if (HAL_I2C_IsDeviceReady(scan->hi2c, addr << 1, 1, I2C_PROBE_TIMEOUT_MS) == HAL_OK) {
+    scan->found[addr >> 5] |= 1UL << (addr & 31);
+    scan->count++;
+  }
+  scan->next = (addr < I2C_SCAN_LAST) ? addr + 1 : 0;
+}
+
+uint8_t I2C_ScanFound(const I2C_ScanState *scan, uint8_t addr) {
+  return (addr < 128) && (scan->found[addr >> 5] & (1UL << (addr & 31))) != 0;
+}
+
+HAL_StatusTypeDef I2C_ScanReport(const I2C_ScanState *scan) {
+  char buffer[160];
+  int bus = (scan->hi2c->Instance == I2C1) ? 1 : 2;
+  int pos = snprintf(buffer, sizeof(buffer), "I2C%d scan:", bus);
+
+  for (uint8_t addr = I2C_SCAN_FIRST; addr <= I2C_SCAN_LAST && pos < (int)sizeof(buffer) - 24; addr++) {
+    if (I2C_ScanFound(scan, addr)) pos += snprintf(&buffer[pos], sizeof(buffer) - pos, " 0x%02x", addr);
+  }
+  pos += snprintf(&buffer[pos], sizeof(buffer) - pos, scan->stuck ? " bus held\r\n" : " (%u)\r\n", scan->count);
+  return dataUart_Write((uint8_t *)buffer, pos);
+}
+
+// Blocking full scan, returns the lowest address found (0 = none)
 uint16_t I2C_Scan(I2C_HandleTypeDef *hi2c) {
-  uint16_t devAddr = 0;
-  for (uint16_t addr = 1; addr < 128; addr++) {
-    if (HAL_I2C_IsDeviceReady(hi2c, addr << 1, 3, 100) == HAL_OK) {
-      devAddr = addr;
-      break;
+  I2C_ScanState scan;
+
+  if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) return 0;
+  I2C_ScanStart(&scan, hi2c);
+  while (I2C_ScanBusy(&scan)) {
+    I2C_ScanStep(&scan);
+  }
+  for (uint16_t addr = I2C_SCAN_FIRST; addr <= I2C_SCAN_LAST; addr++) {
+    if (I2C_ScanFound(&scan, addr)) return addr;
+  }
+  return 0;
+}
+
+// 半個 SCL 週期, 5 us ~ 100 kHz; a tick can land right after start, so wait one more
+static void I2C_DelayHalfClock(void) {
+  uint32_t start = Timebase_Us();
+  while (Timebase_Us() - start <= 5) {
+  }
+}
+
+// Free a bus held by a slave stuck mid-byte and bring the peripheral back:
+// up to 9 SCL pulses until SDA is released, a STOP, then a full re-init
+// (HAL_I2C_Init does the SWRST, MspInit restores the AF pins and DMA)
+HAL_StatusTypeDef I2C_BusRecover(I2C_HandleTypeDef *hi2c) {
+  uint16_t scl, sda;
+  if (hi2c->Instance == I2C1) {
+    scl = GPIO_PIN_6;
+    sda = GPIO_PIN_7;
+  } else if (hi2c->Instance == I2C2) {
+    scl = GPIO_PIN_10;
+    sda = GPIO_PIN_11;
+  } else {
+    return HAL_ERROR;
+  }
+
+  if (I2C_LL_OWNS(hi2c)) I2C_LL_Abort(hi2c);
+  HAL_I2C_DeInit(hi2c);
+
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  HAL_GPIO_WritePin(GPIOB, scl | sda, GPIO_PIN_SET);
+  GPIO_InitStruct.Pin = scl | sda;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+  I2C_DelayHalfClock();
+
+  for (int i = 0; i < 9 && HAL_GPIO_ReadPin(GPIOB, sda) == GPIO_PIN_RESET; i++) {
+    HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_RESET);
+    I2C_DelayHalfClock();
+    HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_SET);
+    I2C_DelayHalfClock();
+  }
+
+  // STOP: SDA 在 SCL 高電位時由低轉高
+  HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_RESET);
+  I2C_DelayHalfClock();
+  HAL_GPIO_WritePin(GPIOB, sda, GPIO_PIN_RESET);
+  I2C_DelayHalfClock();
+  HAL_GPIO_WritePin(GPIOB, scl, GPIO_PIN_SET);
+  I2C_DelayHalfClock();
+  HAL_GPIO_WritePin(GPIOB, sda, GPIO_PIN_SET);
+  I2C_DelayHalfClock();
+
+  uint8_t released = HAL_GPIO_ReadPin(GPIOB, sda) == GPIO_PIN_SET &&
+                     HAL_GPIO_ReadPin(GPIOB, scl) == GPIO_PIN_SET;
+
+  if (HAL_I2C_Init(hi2c) != HAL_OK) return HAL_ERROR;
+  return released ? HAL_OK : HAL_BUSY;
+}
+
+#if PROFILE_ENABLED
+static uint8_t compareBuffer[I2C_COMPARE_MAX];
+
+static uint8_t I2C_CompareBusy(I2C_HandleTypeDef *hi2c, uint8_t ll) {
+  return ll ? I2C_LL_IsBusy(hi2c) : HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY;
+}
+
+// The i2c_irq profile region already times every EV/ER/DMA interrupt of a
+// read (callbacks included), so its sum across the read is the IRQ cost
+static HAL_StatusTypeDef I2C_CompareRead(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint16_t size, uint8_t ll,
+                                         uint32_t *start, uint32_t *irq) {
+  uint64_t irqBefore = Profile_Get(PROFILE_I2C_IRQ)->sum;
+  uint32_t t = DWT->CYCCNT;
+  HAL_StatusTypeDef status = ll ? I2C_LL_Read(hi2c, devAddr, compareBuffer, size)
+                                : HAL_I2C_Master_Receive_DMA(hi2c, devAddr, compareBuffer, size);
+  *start = DWT->CYCCNT - t;
+  if (status != HAL_OK) return status;
+
+  uint32_t begin = Timebase_Us();
+  while (I2C_CompareBusy(hi2c, ll)) {
+    if (Timebase_Us() - begin > I2C_COMPARE_TIMEOUT_US) {
+      if (ll) I2C_LL_Abort(hi2c);
+      return HAL_TIMEOUT;
     }
   }
-  return devAddr;
-}
\ No newline at end of file
+  *irq = (uint32_t)(Profile_Get(PROFILE_I2C_IRQ)->sum - irqBefore);
+  return (hi2c->ErrorCode == HAL_I2C_ERROR_NONE) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef I2C_DriverReport(I2C_HandleTypeDef *hi2c, uint16_t devAddr, uint16_t size) {
+  char buffer[120];
+  uint32_t start[2] = {0}, irq[2] = {0};
+  HAL_StatusTypeDef status[2];
+
+  if (size == 0 || size > I2C_COMPARE_MAX) return HAL_ERROR;
+  for (uint8_t ll = 0; ll < 2; ll++) {
+    status[ll] = I2C_CompareRead(hi2c, devAddr, size, ll, &start[ll], &irq[ll]);
+  }
+
+  int len = snprintf(buffer, sizeof(buffer), "I2C%d read %u B: hal start=%lu irq=%lu%s ll start=%lu irq=%lu%s cyc\r\n",
+                     (hi2c->Instance == I2C1) ? 1 : 2, size, (unsigned long)start[0], (unsigned long)irq[0],
+                     status[0] == HAL_OK ? "" : " (failed)", (unsigned long)start[1], (unsigned long)irq[1],
+                     status[1] == HAL_OK ? "" : " (failed)");
+  return dataUart_Write((uint8_t *)buffer, len);
+}
+#endif  // PROFILE_ENABLED
@@ -0,0 +1,54 @@
+#include "idle.h"
+#include "data_uart.h"
+
+static volatile uint64_t idleCycles = 0;  // 睡眠中的 HCLK 週期
+static uint32_t windowStart = 0;          // HAL_GetTick() at window start
+
+void Idle_Init(void) {
+  idleCycles = 0;
+  windowStart = HAL_GetTick();
+#if IDLE_LOW_POWER
+  RCC->AHBENR &= ~RCC_AHBENR_FLITFEN;  // takes effect in Sleep mode only
+#endif
+}
+
+// WFI with PRIMASK set still wakes on a pending IRQ, but the handler only runs
+// after __enable_irq, so start..end is pure sleep. SysTick wakes us at least
+// once per reload, so its down-counter wraps at most once in between
+void Idle_Sleep(void) {
+  __disable_irq();
+  uint32_t start = SysTick->VAL;
+  __WFI();
+  uint32_t end = SysTick->VAL;
+  uint32_t slept = (start >= end) ? start - end : start + SysTick->LOAD + 1 - end;
+  idleCycles += slept;
+  __enable_irq();
+}
+
+uint16_t Idle_GetLoad(void) {
+  uint32_t ms = HAL_GetTick() - windowStart;
+  uint64_t window = (uint64_t)ms * (SysTick->LOAD + 1);
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint64_t idle = idleCycles;
+  __set_PRIMASK(primask);
+
+  if (window == 0) return 0;
+  if (idle >= window) return 0;
+  return (uint16_t)((window - idle) * 1000 / window);
+}
+
+HAL_StatusTypeDef Idle_Report(void) {
+  uint16_t load = Idle_GetLoad();
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  idleCycles = 0;
+  __set_PRIMASK(primask);
+  windowStart = HAL_GetTick();
+
+  char buffer[32];
+  int len = snprintf(buffer, sizeof(buffer), "cpu load %u.%u%%\r\n", load / 10, load % 10);
+  return dataUart_Write((uint8_t *)buffer, len);
+}
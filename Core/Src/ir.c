@@ -1,19 +1,81 @@
 #include "ir.h"
 #include "led.h"
-
-#define SLAVES_NO 2
-#define SLAVE_1_ADDR (0x30 << 1)
-#define SLAVE_2_ADDR (0x31 << 1)
+#include "profile.h"
+#include "i2c_master.h"
+#include "i2c_ll.h"
+#include "data_uart.h"
+#include "checksum.h"
+#include "timebase.h"
 
 static I2C_HandleTypeDef *I2C_Handle[SLAVES_NO] = {0};
 
-// 雙緩衝設計
-static uint8_t RxBuffer[SLAVES_NO][IR_BUFFER_SIZE] = {0};      // ISR 寫入
-uint8_t ProcessBuffer[SLAVES_NO][IR_BUFFER_SIZE] = {0};        // Main 讀取
+#define QUEUE_MASK (IR_QUEUE_SIZE - 1)
+
+#if (IR_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "IR_QUEUE_SIZE must be a power of two"
+#endif
+
+// SPSC 佇列: ISR 只寫 QueueHead, main 只寫 QueueTail
+// DMA 直接寫入 Queue[QueueHead] (尚未發布), main 擁有 Queue[QueueTail]
+static IR_Frame Queue[IR_QUEUE_SIZE] = {0};
+static volatile uint32_t QueueHead = 0;
+static volatile uint32_t QueueTail = 0;
+static uint8_t QueueHeld = 0;                                  // main 持有 Queue[QueueTail]
+static volatile IR_QueueStats QueueStats = {0};
+uint8_t (*ProcessBuffer)[IR_FRAME_SIZE] = Queue[0].data;       // Main 讀取
 static volatile uint8_t DataReady[SLAVES_NO] = {0};            // 資料就緒標誌
+static volatile uint32_t FrameCount[SLAVES_NO] = {0};          // 完成的讀取次數
+
+// 掃描狀態: 同一條 bus 上的 slave 由完成中斷依序啟動
+static volatile uint8_t SweepPending = 0;                      // 尚未開始的 slave
+static volatile uint8_t SweepInFlight = 0;                     // DMA 進行中的 slave
+static volatile uint8_t SweepDone = 0;                         // 本輪已收到的 slave
+static uint8_t SweepMask = 0;
+static volatile uint8_t SweepOpen = 0;                         // 本輪尚未發布或放棄
+static volatile uint32_t ReadStart = 0;                        // 最近一次讀取開始的 tick
+static IR_Trigger Trigger = IR_TRIGGER_TIMER;
+static volatile uint32_t SweepCount = 0;
+
+// 錯誤復原: ISR 標記需要復原的 slave, main 在 IR_Service 執行
+static volatile IR_ErrorStats ErrorStats[SLAVES_NO] = {0};
+static volatile uint8_t RecoverMask = 0;
+static uint32_t RecoverBackoff = IR_BACKOFF_MIN_MS;
+static uint32_t HoldoffStart = 0;
+static volatile uint32_t HoldoffMs = 0;                        // 復原後暫停 sweep 的時間
+
+// Hot-plug: 連續失敗的 slave 移出 sweep, 之後只定期探測
+static volatile uint8_t PresentMask = 0;
+static uint8_t MissCount[SLAVES_NO] = {0};
+static uint8_t SaveFresh = 0;  // IR_SaveData: frame taken for SLAVE_1 was new
+static uint32_t LastProbe = 0;
+static volatile uint8_t BusClaimed = 0;
+
+// Frame check: 每個 slave 上一個接受的序號
+static uint8_t FrameCheck = 0;
+static uint8_t LastSeq[SLAVES_NO] = {0};
+static uint8_t SeqValid = 0;                                   // LastSeq 有效的 slave
+
+// ROI: 本輪每個 slave 讀取的眼睛範圍, RoiLen == EYE_NUM 為完整讀取
+static uint8_t RoiSpan = 0;                                    // 0 = 關閉
+static uint8_t RoiCountdown = 0;                               // ROI 輪數, 到 0 強制完整 sweep
+static uint8_t RoiFirst[SLAVES_NO] = {0};
+static uint8_t RoiLen[SLAVES_NO] = {EYE_NUM, EYE_NUM};
+
+// Register reads (ROI window, batch): 先用中斷送出暫存器位元組, TX 完成後再 DMA 讀取
+static uint8_t RegByte[SLAVES_NO] = {0};
+static uint8_t *RegDest[SLAVES_NO] = {0};
+static uint16_t RegSize[SLAVES_NO] = {0};
+static volatile uint8_t RegPending[SLAVES_NO] = {0};           // 暫存器已送出, 等待讀取階段
+
+// Batch: DMA 先寫入暫存區, 整輪完成後再拆成 Batch 個 frame
+static uint8_t Batch = 1;
+static uint32_t BatchPeriodUs = 0;
+static uint8_t BatchBuffer[SLAVES_NO][IR_BATCH_MAX * IR_FRAME_SIZE];
+static uint8_t BatchValid[SLAVES_NO] = {0};                    // bit per sample that passed the check
 
 uint8_t maxEye = 0;
 uint16_t maxValue = 0;
+Bearing ballBearing = {0};
 static uint16_t eyeValues[SLAVES_NO * EYE_NUM] = {0};
 
 void IR_Init(I2C_HandleTypeDef *hi2c1, I2C_HandleTypeDef *hi2c2) {
@@ -21,79 +83,590 @@ void IR_Init(I2C_HandleTypeDef *hi2c1, I2C_HandleTypeDef *hi2c2) {
   I2C_Handle[SLAVE_2] = hi2c2;
   
   // 清除所有緩衝區和狀態
+  memset(Queue, 0, sizeof(Queue));
   for (int i = 0; i < SLAVES_NO; i++) {
-    memset(RxBuffer[i], 0, IR_BUFFER_SIZE);
-    memset(ProcessBuffer[i], 0, IR_BUFFER_SIZE);
     DataReady[i] = 0;
   }
+  QueueHead = 0;
+  QueueTail = 0;
+  QueueHeld = 0;
+  QueueStats.produced = 0;
+  QueueStats.consumed = 0;
+  QueueStats.overwritten = 0;
+  ProcessBuffer = Queue[0].data;
+  SweepPending = 0;
+  SweepInFlight = 0;
+  memset((void *)ErrorStats, 0, sizeof(ErrorStats));
+  RecoverMask = 0;
+  RecoverBackoff = IR_BACKOFF_MIN_MS;
+  HoldoffMs = 0;
+  LED_SetErrorCode(IR_FAULT_NONE);
+  PresentMask = 0;
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if (I2C_Handle[sid] != NULL) PresentMask |= 1U << sid;
+    MissCount[sid] = 0;
+  }
+  SaveFresh = 0;
+  LastProbe = HAL_GetTick();
+  BusClaimed = 0;
+  SweepOpen = 0;
+  Trigger = IR_TRIGGER_TIMER;
+  FrameCheck = 0;
+  SeqValid = 0;
+  RoiSpan = 0;
+  RoiCountdown = 0;
+  memset((void *)RegPending, 0, sizeof(RegPending));
+  Batch = 1;
+  BatchPeriodUs = 0;
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    RoiFirst[sid] = 0;
+    RoiLen[sid] = EYE_NUM;
+  }
+}
+
+void IR_SetTrigger(IR_Trigger trigger) { Trigger = trigger; }
+
+void IR_SetFrameCheck(uint8_t enable) {
+  FrameCheck = enable ? 1 : 0;
+  SeqValid = 0;
+}
+
+void IR_SetRoi(uint8_t span) {
+  RoiSpan = (span > IR_ROI_MAX_SPAN) ? IR_ROI_MAX_SPAN : span;
+  RoiCountdown = 0;
 }
 
+void IR_SetBatch(uint8_t samples, uint32_t period_us) {
+  if (samples < 1) samples = 1;
+  Batch = (samples > IR_BATCH_MAX) ? IR_BATCH_MAX : samples;
+  BatchPeriodUs = period_us;
+}
+
+// Bytes of one sample on the wire: full payload plus the trailer if checked
+static uint16_t IR_SampleSize(void) {
+  return IR_BUFFER_SIZE + (FrameCheck ? IR_FRAME_SIZE - IR_BUFFER_SIZE : 0);
+}
+
+static uint16_t IR_SlaveAddr(int sid) { return (sid == SLAVE_1) ? SLAVE_1_ADDR : SLAVE_2_ADDR; }
+
+// Call with interrupts enabled: the start may wait (bounded) for BUSY to clear
 HAL_StatusTypeDef IR_ReadData(Slave_ID slaves_id) {
   if (I2C_Handle[slaves_id] == NULL) { 
     return HAL_ERROR; 
   }
 
+  uint16_t devAddr = IR_SlaveAddr(slaves_id);
+  uint8_t *dest = Queue[QueueHead & QUEUE_MASK].data[slaves_id];
+  uint8_t first = RoiFirst[slaves_id];
+  uint8_t len = RoiLen[slaves_id];
+  // Vref + eyes (+ seq, CRC); IR_RxComplete moves a window's eyes into place
+  uint16_t size = IR_SampleSize() - (EYE_NUM - len) * 2;
+  uint8_t reg = IR_REG_WINDOW(first, len);
+  HAL_StatusTypeDef status;
+
+  if (Batch > 1) {
+    dest = BatchBuffer[slaves_id];
+    size = Batch * IR_SampleSize();
+    reg = IR_REG_BATCH(Batch);
+  }
+
+  PROFILE_BEGIN(PROFILE_I2C_START);
+#if IR_USE_LL_I2C
+  // The LL driver tracks its own transfer, no HAL state to check
+  if (len < EYE_NUM || Batch > 1) {
+    status = I2C_LL_MemRead(I2C_Handle[slaves_id], devAddr, reg, dest, size);
+  } else {
+    status = I2C_LL_Read(I2C_Handle[slaves_id], devAddr, dest, size);
+  }
+#else
   // Check if I2C is busy
   if (HAL_I2C_GetState(I2C_Handle[slaves_id]) != HAL_I2C_STATE_READY) {
     return HAL_BUSY;
   }
 
-  uint16_t devAddr = (slaves_id == SLAVE_1) ? SLAVE_1_ADDR : SLAVE_2_ADDR;
-  HAL_StatusTypeDef status = HAL_I2C_Master_Receive_DMA(
-    I2C_Handle[slaves_id],
-    devAddr,
-    RxBuffer[slaves_id],
-    IR_BUFFER_SIZE
-  );
+  if (len < EYE_NUM || Batch > 1) {
+    // HAL_I2C_Mem_Read_DMA polls the whole address phase with a tick timeout;
+    // send the register by interrupt, the read follows in MasterTxCpltCallback
+    RegByte[slaves_id] = reg;
+    RegDest[slaves_id] = dest;
+    RegSize[slaves_id] = size;
+    RegPending[slaves_id] = 1;
+    status = HAL_I2C_Master_Seq_Transmit_IT(I2C_Handle[slaves_id], devAddr, &RegByte[slaves_id], 1, I2C_FIRST_FRAME);
+    if (status != HAL_OK) RegPending[slaves_id] = 0;
+  } else {
+    status = HAL_I2C_Master_Receive_DMA(I2C_Handle[slaves_id], devAddr, dest, size);
+  }
+#endif
+  PROFILE_END(PROFILE_I2C_START);
   
   return status;
 }
 
+// Copy one slave's part of a frame, returns 1 if the frame was new. SLAVE_1
+// takes the next queued frame, the other slaves copy from that same frame
 uint8_t IR_SaveData(Slave_ID slave_id, uint8_t *data, uint16_t size) {
-  if (DataReady[slave_id]) {
-    // 複製資料
-    size = (size > IR_BUFFER_SIZE) ? IR_BUFFER_SIZE : size;
-    memcpy(data, ProcessBuffer[slave_id], size);
+  if (slave_id == SLAVE_1) SaveFresh = IR_AcquireFrame();
 
-    // 清除標誌
-    DataReady[slave_id] = 0;
-    return 1;  // 成功
-  }
-  return 0;  // 無新資料
+  // 複製資料
+  size = (size > IR_BUFFER_SIZE) ? IR_BUFFER_SIZE : size;
+  memcpy(data, IR_CurrentFrame()->data[slave_id], size);
+  return SaveFresh;
 }
 
 uint8_t IR_IsDataReady(Slave_ID slave_id) { return DataReady[slave_id]; }
 
 void IR_ClearDataReady(Slave_ID slave_id) { DataReady[slave_id] = 0; }
 
+uint32_t IR_GetFrameCount(Slave_ID slave_id) { return FrameCount[slave_id]; }
+
+// A read of this slave failed; after IR_HOTPLUG_MISSES in a row it is detached
+static void IR_SlaveMissed(int sid) {
+  if (MissCount[sid] < IR_HOTPLUG_MISSES) MissCount[sid]++;
+  if (MissCount[sid] == IR_HOTPLUG_MISSES && (PresentMask & (1U << sid))) {
+    PresentMask &= ~(1U << sid);
+    SeqValid &= ~(1U << sid);  // a re-attached slave starts a new sequence
+    ErrorStats[sid].detached++;
+  }
+}
+
+static void IR_SweepFinish(void);
+static void IR_Publish(void);
+static void IR_BatchUnpack(void);
+
+// Move the next pending slave on this bus in flight, -1 if the bus is busy or
+// has nothing left (then the sweep may be complete); called under PRIMASK
+static int IR_SweepClaim(I2C_HandleTypeDef *hi2c) {
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if ((SweepInFlight & (1U << sid)) && I2C_Handle[sid] == hi2c) return -1;
+  }
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    uint8_t bit = 1U << sid;
+    if (!(SweepPending & bit) || I2C_Handle[sid] != hi2c) continue;
+
+    SweepPending &= ~bit;
+    SweepInFlight |= bit;
+    ReadStart = HAL_GetTick();
+    return sid;
+  }
+  IR_SweepFinish();
+  return -1;
+}
+
+// Start the next pending slave on this bus. Never call under PRIMASK: the
+// claim is atomic, the read start runs with the other bus' interrupts live
+static void IR_SweepNext(I2C_HandleTypeDef *hi2c) {
+  for (;;) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int sid = IR_SweepClaim(hi2c);
+    __set_PRIMASK(primask);
+    if (sid < 0) return;
+
+    if (IR_ReadData((Slave_ID)sid) == HAL_OK) return;
+
+    // 啟動失敗, 跳過這個 slave 繼續下一個
+    uint8_t bit = 1U << sid;
+    uint8_t stuck = (hi2c->ErrorCode & HAL_I2C_ERROR_TIMEOUT) != 0;
+    primask = __get_PRIMASK();
+    __disable_irq();
+    SweepInFlight &= ~bit;
+    IR_SlaveMissed(sid);
+    if (stuck) {
+      // BUSY flag never cleared, SDA is probably held low
+      ErrorStats[sid].timeout++;
+      RecoverMask |= bit;
+      LED_SetErrorCode(IR_FAULT_TIMEOUT);
+    }
+    __set_PRIMASK(primask);
+    if (stuck) IR_BusErrorCallback();
+  }
+}
+
+// Publish once every present slave has delivered; a transient failure of a
+// present slave drops the sweep, a detached slave's part is zeroed
+static void IR_SweepFinish(void) {
+  if (SweepPending == 0 && SweepInFlight == 0 && SweepDone != 0 &&
+      SweepDone == (SweepMask & PresentMask)) {
+    SweepOpen = 0;
+    RecoverBackoff = IR_BACKOFF_MIN_MS;
+    LED_SetErrorCode(IR_FAULT_NONE);  // every present slave answered, the buses are back
+    if (Batch > 1) {
+      IR_BatchUnpack();
+      return;
+    }
+    SweepCount++;
+    IR_Publish();
+  }
+}
+
+// Queue the head slot as a frame of the slaves in SweepDone
+static void IR_Publish(void) {
+  // Keep the write slot clear of everything the consumer has not released
+  if (QueueHead - QueueTail >= IR_QUEUE_SIZE - 1) {
+    QueueStats.overwritten++;  // slot is reused by the next sweep
+    return;
+  }
+  IR_Frame *frame = &Queue[QueueHead & QUEUE_MASK];
+  frame->eyeMask = 0;
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if (!(SweepDone & (1U << sid))) {
+      memset(frame->data[sid], 0, IR_FRAME_SIZE);
+      continue;
+    }
+    frame->eyeMask |= ((1U << RoiLen[sid]) - 1) << (sid * EYE_NUM + RoiFirst[sid]);
+  }
+  frame->present = SweepDone;
+  frame->dmaDone = Timebase_Us();
+  __DMB();  // frame contents before the new head
+  QueueHead = QueueHead + 1;
+  QueueStats.produced++;
+  IR_FrameReadyCallback();
+}
+
+// One frame per sample that passed on every slave, oldest first; the slave
+// took them BatchPeriodUs apart, the newest one just before the read started
+static void IR_BatchUnpack(void) {
+  IR_Frame *open = &Queue[QueueHead & QUEUE_MASK];
+  uint32_t timestamp = open->timestamp;
+  uint32_t dmaStart = open->dmaStart;
+  uint16_t stride = IR_SampleSize();
+  uint8_t common = 0xFF;
+
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if (SweepDone & (1U << sid)) common &= BatchValid[sid];
+  }
+
+  for (int j = 0; j < Batch; j++) {
+    uint32_t seq = SweepCount++;
+    if (!(common & (1U << j))) continue;
+
+    // The head slot is never the consumer's, filling it before the check is safe
+    IR_Frame *frame = &Queue[QueueHead & QUEUE_MASK];
+    for (int sid = 0; sid < SLAVES_NO; sid++) {
+      if (SweepDone & (1U << sid)) memcpy(frame->data[sid], &BatchBuffer[sid][j * stride], stride);
+    }
+    frame->timestamp = timestamp - (uint32_t)(Batch - 1 - j) * BatchPeriodUs;
+    frame->seq = seq;
+    frame->dmaStart = dmaStart;
+    IR_Publish();
+  }
+}
+
+static uint8_t IR_Configured(void) {
+  uint8_t configured = 0;
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if (I2C_Handle[sid] != NULL) configured |= 1U << sid;
+  }
+  return configured;
+}
+
+// Eye window of each slave for the next frame: all eyes on a full sweep,
+// else the eyes within ±RoiSpan of the last maxEye. Returns the slaves to read
+static uint8_t IR_RoiPlan(uint8_t full) {
+  uint8_t mask = 0;
+
+  if (RoiSpan == 0 || RoiCountdown == 0 || Batch > 1) full = 1;
+  if (full) {
+    if (RoiSpan) RoiCountdown = IR_ROI_FULL_EVERY - 1;
+    for (int sid = 0; sid < SLAVES_NO; sid++) {
+      RoiFirst[sid] = 0;
+      RoiLen[sid] = EYE_NUM;
+      mask |= 1U << sid;
+    }
+    return mask;
+  }
+
+  RoiCountdown--;
+  for (int sid = 0; sid < SLAVES_NO; sid++) RoiLen[sid] = 0;
+  // 眼睛排成一圈, 跨 slave 的窗口在每個 slave 內仍然連續
+  for (int d = -RoiSpan; d <= RoiSpan; d++) {
+    int eye = (maxEye + d + SLAVES_NO * EYE_NUM) % (SLAVES_NO * EYE_NUM);
+    int sid = eye / EYE_NUM;
+    if (RoiLen[sid] == 0) RoiFirst[sid] = eye % EYE_NUM;
+    RoiLen[sid]++;
+    mask |= 1U << sid;
+  }
+  return mask;
+}
+
+// New frame in the head slot, returns the part of mask the ROI plan reads;
+// caller holds off interrupts
+static uint8_t IR_SweepOpen(uint8_t mask, uint8_t full) {
+  mask &= IR_RoiPlan(full);
+  SweepMask = mask;
+  SweepDone = 0;
+  SweepOpen = 1;
+  uint32_t now = Timebase_Us();
+  Queue[QueueHead & QUEUE_MASK].timestamp = now;
+  Queue[QueueHead & QUEUE_MASK].seq = SweepCount;
+  Queue[QueueHead & QUEUE_MASK].dmaStart = now;
+  return mask;
+}
+
+// One read per configured slave; slaves sharing a bus are chained from the
+// completion interrupt so the main loop only sees the assembled frame
+HAL_StatusTypeDef IR_StartSweep(void) {
+  uint8_t mask = 0;
+
+  if (Trigger != IR_TRIGGER_TIMER) return HAL_BUSY;
+  if (SweepPending || SweepInFlight || RecoverMask || BusClaimed) return HAL_BUSY;
+  uint32_t now = HAL_GetTick();
+  if (HoldoffMs && now - HoldoffStart < HoldoffMs) return HAL_BUSY;
+
+  uint8_t configured = IR_Configured();
+  if (configured == 0) return HAL_ERROR;
+
+  // Detached slaves ride along as probes now and then, a NACK costs one address
+  uint8_t probe = 0;
+  mask = configured & PresentMask;
+  if ((configured & ~PresentMask) && now - LastProbe >= IR_HOTPLUG_PROBE_MS) {
+    LastProbe = now;
+    mask = configured;
+    probe = 1;
+  }
+  if (mask == 0) return HAL_BUSY;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  mask = IR_SweepOpen(mask, probe);
+  SweepPending = mask;
+  ReadStart = now;
+  __set_PRIMASK(primask);
+  IR_SweepStartCallback();
+
+  // First slave of each bus starts now, the rest follow in the ISR
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    uint8_t shared = 0;
+    for (int other = 0; other < sid; other++) {
+      if ((mask & (1U << other)) && I2C_Handle[other] == I2C_Handle[sid]) shared = 1;
+    }
+    if ((mask & (1U << sid)) && !shared) IR_SweepNext(I2C_Handle[sid]);
+  }
+
+  return HAL_OK;
+}
+
+// Data-ready edge from one slave: read it now (or right after the slave ahead
+// of it on the same bus); the frame publishes once every present slave is in
+void IR_SlaveReady(Slave_ID slave_id) {
+  uint8_t bit = 1U << slave_id;
+
+  if (Trigger != IR_TRIGGER_DATA_READY || I2C_Handle[slave_id] == NULL) return;
+  if (RecoverMask || BusClaimed) return;
+  if (HoldoffMs && HAL_GetTick() - HoldoffStart < HoldoffMs) return;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint8_t opened = !SweepOpen;
+  if (opened) IR_SweepOpen(IR_Configured() & PresentMask, 0);
+
+  // Already read in this frame, the other slave is behind; keep the older sample.
+  // Outside the ROI window: not needed for this frame at all
+  if (((SweepDone | SweepInFlight | SweepPending) & bit) || RoiLen[slave_id] == 0) {
+    __set_PRIMASK(primask);
+    if (opened) IR_SweepStartCallback();
+    return;
+  }
+
+  // A detached slave signalling again is back, try it in this frame
+  SweepMask |= bit;
+  SweepPending |= bit;
+  __set_PRIMASK(primask);
+  if (opened) IR_SweepStartCallback();
+
+  // A busy bus picks it up when the read ahead of it completes
+  IR_SweepNext(I2C_Handle[slave_id]);
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  if (GPIO_Pin == IR_DRDY1_Pin) IR_SlaveReady(SLAVE_1);
+  if (GPIO_Pin == IR_DRDY2_Pin) IR_SlaveReady(SLAVE_2);
+}
+
+uint8_t IR_IsFrameReady(void) { return (QueueHead - QueueTail) > QueueHeld; }
+
+// Frames queued and not yet released, the held one included
+uint8_t IR_QueueDepth(void) { return (uint8_t)(QueueHead - QueueTail); }
+
+// Release the frame taken last time and take the oldest queued one;
+// ProcessBuffer stays valid and untouched by DMA until the next call
+uint8_t IR_AcquireFrame(void) {
+  if (QueueHeld) {
+    __DMB();  // finish reading the slot before handing it back
+    QueueTail = QueueTail + 1;
+    QueueStats.consumed++;
+    QueueHeld = 0;
+  }
+
+  if (QueueHead == QueueTail) return 0;
+  __DMB();  // head before frame contents
+
+  ProcessBuffer = Queue[QueueTail & QUEUE_MASK].data;
+  QueueHeld = 1;
+  for (int sid = 0; sid < SLAVES_NO; sid++) DataReady[sid] = 0;
+  return 1;
+}
+
+// Frame currently owned by the consumer (valid after IR_AcquireFrame returned 1)
+const IR_Frame *IR_CurrentFrame(void) { return &Queue[QueueTail & QUEUE_MASK]; }
+
+// Payloads of the current frame back to back, without the trailers
+uint16_t IR_CopyPayload(uint8_t *out) {
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    memcpy(&out[sid * IR_BUFFER_SIZE], ProcessBuffer[sid], IR_BUFFER_SIZE);
+  }
+  return SLAVES_NO * IR_BUFFER_SIZE;
+}
+
+void IR_GetQueueStats(IR_QueueStats *stats) {
+  stats->produced = QueueStats.produced;
+  stats->consumed = QueueStats.consumed;
+  stats->overwritten = QueueStats.overwritten;
+}
+
+uint32_t IR_GetSweepCount(void) { return SweepCount; }
+
+// Find the slave whose read just finished on this bus (one per bus at a time)
+static int IR_InFlightSlave(I2C_HandleTypeDef *hi2c) {
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if ((SweepInFlight & (1U << sid)) && I2C_Handle[sid] == hi2c) return sid;
+  }
+  return -1;
+}
+
 uint16_t combine_data(uint8_t msb, uint8_t lsb) { return (msb << 8) | lsb; }
 
-float IR_ADC_to_Voltage(uint16_t adc_value, float vref) {
-  // 假設 12-bit ADC (0-4095)
-  return (adc_value * vref) / 4095.0f;
+// Eye reading in mV, scaled by the VREFINT sample taken in the same sweep:
+// mV = adc * VREFINT_mV / vref_raw (rounded, integer only)
+uint16_t IR_ADC_to_mV(uint16_t adc_value, uint16_t vref_raw) {
+  if (vref_raw == 0) return 0;
+  return ((uint32_t)adc_value * IR_VREFINT_MV + vref_raw / 2) / vref_raw;
+}
+
+// Slave supply voltage in mV
+uint16_t IR_Vdda_mV(uint16_t vref_raw) { return IR_ADC_to_mV(IR_ADC_FULL_SCALE, vref_raw); }
+
+// All eyes of a frame in mV, each slave scaled by its own Vref word
+void IR_NormalizeFrame(uint8_t (*frame)[IR_FRAME_SIZE], uint16_t *eyes_mv) {
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    uint16_t vref = combine_data(frame[sid][1], frame[sid][0]);
+    for (int i = 0; i < EYE_NUM; i++) {
+      uint16_t raw = combine_data(frame[sid][3 + i * 2], frame[sid][2 + i * 2]);
+      eyes_mv[sid * EYE_NUM + i] = IR_ADC_to_mV(raw, vref);
+    }
+  }
+}
+
+// Trailer check of a checked frame (seq, CRC right after len payload bytes),
+// 0 = drop it; ~250 cycles for a full frame with the nibble table
+static uint8_t IR_FrameValid(int sid, const uint8_t *raw, uint16_t len) {
+  uint8_t bit = 1U << sid;
+
+  if (!FrameCheck) return 1;
+  uint8_t crc = Checksum_CRC8(CRC8_INIT, raw, len + 1) ^ CRC8_XOROUT;
+  if (crc != raw[len + 1]) {
+    ErrorStats[sid].crc++;
+    return 0;
+  }
+
+  // 序號相同 = slave 還沒有新樣本, 重複讀到同一筆
+  uint8_t seq = raw[len];
+  if (SeqValid & bit) {
+    uint8_t step = seq - LastSeq[sid];
+    if (step == 0) {
+      ErrorStats[sid].duplicate++;
+      return 0;
+    }
+    ErrorStats[sid].gap += step - 1;
+  }
+  LastSeq[sid] = seq;
+  SeqValid |= bit;
+  return 1;
 }
 
 /* I2C event callback */
+static void IR_RxComplete(I2C_HandleTypeDef *hi2c) {
+  int sid = IR_InFlightSlave(hi2c);
+
+  if (sid < 0) {
+    // Plain IR_ReadData outside a sweep; reads by whoever holds the bus are not frames
+    if (BusClaimed) return;
+    for (sid = 0; sid < SLAVES_NO; sid++) {
+      if (hi2c == I2C_Handle[sid]) break;
+    }
+    if (sid == SLAVES_NO) return;
+  }
+
+  // Runs at the DMA level, where the other bus' EV/ER handlers (IRQ_PRIO_BUS)
+  // can pre-empt it and touch the same sweep state
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  // The slave answered, whatever the payload looks like
+  MissCount[sid] = 0;
+  if (!(PresentMask & (1U << sid))) {
+    PresentMask |= 1U << sid;
+    ErrorStats[sid].attached++;
+  }
+
+  // A bad frame never counts as delivered, so the sweep is not published
+  uint8_t *raw = Queue[QueueHead & QUEUE_MASK].data[sid];
+  uint8_t valid;
+  if (Batch > 1) {
+    // Each sample is checked on its own, IR_BatchUnpack skips the bad ones
+    uint16_t stride = IR_SampleSize();
+    BatchValid[sid] = 0;
+    for (int j = 0; j < Batch; j++) {
+      if (IR_FrameValid(sid, &BatchBuffer[sid][j * stride], IR_BUFFER_SIZE)) BatchValid[sid] |= 1U << j;
+    }
+    valid = BatchValid[sid] != 0;
+  } else {
+    valid = IR_FrameValid(sid, raw, 2 + RoiLen[sid] * 2);
+  }
+  if (valid && RoiLen[sid] < EYE_NUM) {
+    // Window read [Vref][eyes from RoiFirst]: eyes back to their full-frame offsets
+    memmove(&raw[2 + RoiFirst[sid] * 2], &raw[2], RoiLen[sid] * 2);
+    memset(&raw[2], 0, RoiFirst[sid] * 2);
+    memset(&raw[2 + (RoiFirst[sid] + RoiLen[sid]) * 2], 0, (EYE_NUM - RoiFirst[sid] - RoiLen[sid]) * 2);
+  }
+  if (valid) {
+    // 設定資料就緒標誌 (DMA 已直接寫入 FrameBuffer, 不需複製)
+    DataReady[sid] = 1;
+    FrameCount[sid]++;
+  }
+
+  uint8_t chained = (SweepInFlight & (1U << sid)) != 0;
+  if (chained) {
+    SweepInFlight &= ~(1U << sid);
+    if (valid) SweepDone |= 1U << sid;
+  }
+  __set_PRIMASK(primask);
+
+  if (chained) IR_SweepNext(hi2c);
+}
+
 void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  PROFILE_BEGIN(PROFILE_I2C_CALLBACK);
+  IR_RxComplete(hi2c);
+  PROFILE_END(PROFILE_I2C_CALLBACK);
+}
+
+/* Register byte of a window/batch read sent: repeated START, read by DMA */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
   for (int sid = 0; sid < SLAVES_NO; sid++) {
-    if (hi2c == I2C_Handle[sid]) {
-      // 複製到處理緩衝區
-      memcpy(ProcessBuffer[sid], RxBuffer[sid], IR_BUFFER_SIZE);
-      
-      // 設定資料就緒標誌
-      DataReady[sid] = 1;
-      
-      break;
+    if (!RegPending[sid] || I2C_Handle[sid] != hi2c) continue;
+
+    RegPending[sid] = 0;
+    if (HAL_I2C_Master_Seq_Receive_DMA(hi2c, IR_SlaveAddr(sid), RegDest[sid], RegSize[sid], I2C_LAST_FRAME) != HAL_OK) {
+      HAL_I2C_ErrorCallback(hi2c);
     }
+    return;
   }
 }
 
+// Works on the frame last taken with IR_AcquireFrame (eyes 0-6 from SLAVE_1, 7-13 from SLAVE_2)
 void updateValues() {
-  // Require both slaves to have new data
-  DataReady[SLAVE_2] = 1;
-  if (!IR_IsDataReady(SLAVE_1) || !IR_IsDataReady(SLAVE_2)) {
-    return; // No new data to process
-  }
+  PROFILE_BEGIN(PROFILE_UPDATE_VALUES);
 
   // Reset previous result before recomputing
   maxValue = 0;
@@ -116,16 +689,185 @@ void updateValues() {
       maxEye = i;
     }
   }
+
+  // Sub-eye bearing from the vector sum of all eyes
+  Bearing_Compute(eyeValues, &ballBearing);
+  LED_SetPattern(maxValue > IR_BALL_THRESHOLD ? LED_PATTERN_BALL : LED_PATTERN_FRAME);
+
+  PROFILE_END(PROFILE_UPDATE_VALUES);
+}
+
+// Errors that need a bus recovery, worst first
+static IR_Fault IR_ClassifyFault(uint32_t error) {
+  if (error & HAL_I2C_ERROR_BERR) return IR_FAULT_BUS_ERROR;
+  if (error & HAL_I2C_ERROR_ARLO) return IR_FAULT_ARBITRATION;
+  if (error & HAL_I2C_ERROR_DMA) return IR_FAULT_DMA;
+  if (error & HAL_I2C_ERROR_TIMEOUT) return IR_FAULT_TIMEOUT;
+  return IR_FAULT_NONE;
 }
 
 /* I2C error callback */
 void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
-  // Handle I2C errors
+  int failed = IR_InFlightSlave(hi2c);
+  int sid = failed;
+  if (sid < 0) {
+    for (sid = 0; sid < SLAVES_NO; sid++) {
+      if (hi2c == I2C_Handle[sid]) break;
+    }
+    if (sid == SLAVES_NO) return;
+  }
+
+  uint32_t error = hi2c->ErrorCode;
+  volatile IR_ErrorStats *stats = &ErrorStats[sid];
+  uint32_t primask = __get_PRIMASK();  // DMA errors land here from a lower level
+  __disable_irq();
+  for (int other = 0; other < SLAVES_NO; other++) {
+    if (I2C_Handle[other] == hi2c) RegPending[other] = 0;
+  }
+  if (error & HAL_I2C_ERROR_AF) stats->nack++;
+  if (error & HAL_I2C_ERROR_BERR) stats->busError++;
+  if (error & HAL_I2C_ERROR_ARLO) stats->arbitration++;
+  if (error & HAL_I2C_ERROR_OVR) stats->overrun++;
+  if (error & HAL_I2C_ERROR_DMA) stats->dma++;
+  if (error & HAL_I2C_ERROR_TIMEOUT) stats->timeout++;
+
+  // NACK and overrun leave the bus idle, the next sweep just retries;
+  // the rest may leave SDA held or the peripheral wedged
+  IR_Fault fault = IR_ClassifyFault(error);
+  if (fault != IR_FAULT_NONE) {
+    RecoverMask |= 1U << sid;
+    LED_SetErrorCode(fault);
+  }
+
+  // Drop the failed slave from the sweep so the rest of the bus still runs
+  uint8_t next = 0;
+  if (failed >= 0) {
+    IR_SlaveMissed(failed);
+    SweepInFlight &= ~(1U << failed);
+    next = !(RecoverMask & (1U << failed));
+  }
+  __set_PRIMASK(primask);
+  if (next) IR_SweepNext(hi2c);
+  IR_BusErrorCallback();
+}
+
+__attribute__((weak)) void IR_FrameReadyCallback(void) {}
+
+__attribute__((weak)) void IR_BusErrorCallback(void) {}
+
+__attribute__((weak)) void IR_SweepStartCallback(void) {}
+
+uint8_t IR_ServiceDue(void) {
+  uint8_t open = Trigger == IR_TRIGGER_DATA_READY && SweepOpen;
+  return SweepPending || SweepInFlight || RecoverMask || open;
+}
+
+void IR_Service(void) {
+  uint32_t now = HAL_GetTick();
+
+  // A read that never completes (no callback at all) counts as a timeout
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if ((SweepPending || SweepInFlight) && now - ReadStart > IR_I2C_TIMEOUT_MS) {
+    for (int sid = 0; sid < SLAVES_NO; sid++) {
+      if (SweepInFlight & (1U << sid)) {
+        ErrorStats[sid].timeout++;
+        RecoverMask |= 1U << sid;
+        LED_SetErrorCode(IR_FAULT_TIMEOUT);
+        IR_SlaveMissed(sid);
+      }
+    }
+    SweepPending = 0;
+    SweepInFlight = 0;
+  }
+
+  // Data-ready mode: a slave that never signals would hold the frame forever
+  if (Trigger == IR_TRIGGER_DATA_READY && SweepOpen && !SweepPending && !SweepInFlight &&
+      Timebase_Us() - Queue[QueueHead & QUEUE_MASK].timestamp > IR_DRDY_TIMEOUT_MS * 1000U) {
+    for (int sid = 0; sid < SLAVES_NO; sid++) {
+      if ((SweepMask & PresentMask & ~SweepDone) & (1U << sid)) IR_SlaveMissed(sid);
+    }
+    IR_SweepFinish();  // publishes if the silent slave just got detached
+    SweepOpen = 0;
+  }
+  uint8_t recover = RecoverMask;
+  __set_PRIMASK(primask);
+
+  if (recover == 0) return;
+
+  // Sweeps are held off while RecoverMask is set; one recovery per bus
+  uint8_t busMask = 0;  // every slave on a recovered bus
   for (int sid = 0; sid < SLAVES_NO; sid++) {
-    if (hi2c == I2C_Handle[sid]) {
-      // Clear error state - the next request will retry
-      // You can add error counting or logging here if needed
-      break;
+    if (!(recover & (1U << sid)) || I2C_Handle[sid] == NULL) continue;
+
+    uint8_t done = 0;
+    for (int other = 0; other < SLAVES_NO; other++) {
+      if (I2C_Handle[other] != I2C_Handle[sid]) continue;
+      if (other < sid && (recover & (1U << other))) done = 1;
+      busMask |= 1U << other;
     }
+    if (!done) I2C_BusRecover(I2C_Handle[sid]);
+    ErrorStats[sid].recoveries++;
+  }
+
+  // Only the recovered buses lose their reads, the other bus finishes its own.
+  // Errors raised since the snapshot stay in RecoverMask for the next pass
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (SweepMask & busMask & ~SweepDone) SweepOpen = 0;
+  SweepPending &= ~busMask;
+  SweepInFlight &= ~busMask;
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    if (busMask & (1U << sid)) RegPending[sid] = 0;
+  }
+  // Back off before the next sweep, doubling while recoveries keep failing
+  HoldoffStart = HAL_GetTick();
+  HoldoffMs = RecoverBackoff;
+  RecoverMask &= ~recover;
+  __set_PRIMASK(primask);
+  if (RecoverBackoff < IR_BACKOFF_MAX_MS) RecoverBackoff *= 2;
+}
+
+void IR_GetErrorStats(Slave_ID slave_id, IR_ErrorStats *stats) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = ErrorStats[slave_id];
+  __set_PRIMASK(primask);
+}
+
+uint8_t IR_GetPresentMask(void) { return PresentMask; }
+
+uint8_t IR_ClaimBus(void) {
+  uint8_t claimed = 0;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!SweepPending && !SweepInFlight) {
+    BusClaimed = 1;
+    claimed = 1;
+  }
+  __set_PRIMASK(primask);
+  return claimed;
+}
+
+void IR_ReleaseBus(void) { BusClaimed = 0; }
+
+HAL_StatusTypeDef IR_ErrorReport(void) {
+  char buffer[400];
+  int len = 0;
+
+  for (int sid = 0; sid < SLAVES_NO; sid++) {
+    IR_ErrorStats e;
+    IR_GetErrorStats((Slave_ID)sid, &e);
+    len += snprintf(&buffer[len], sizeof(buffer) - len,
+                    "Slave%d %s: nack %lu berr %lu arlo %lu ovr %lu dma %lu tmo %lu rec %lu det %lu att %lu"
+                    " crc %lu dup %lu gap %lu\r\n",
+                    sid + 1, (PresentMask & (1U << sid)) ? "up" : "down",
+                    (unsigned long)e.nack, (unsigned long)e.busError,
+                    (unsigned long)e.arbitration, (unsigned long)e.overrun,
+                    (unsigned long)e.dma, (unsigned long)e.timeout, (unsigned long)e.recoveries,
+                    (unsigned long)e.detached, (unsigned long)e.attached,
+                    (unsigned long)e.crc, (unsigned long)e.duplicate, (unsigned long)e.gap);
+    if (len >= (int)sizeof(buffer)) return HAL_ERROR;
   }
-}
\ No newline at end of file
+  return dataUart_Write((uint8_t *)buffer, len);
+}
@@ -0,0 +1,84 @@
+#include "irq.h"
+#include "data_uart.h"
+
+#if IRQ_PROBE_ENABLED
+
+static const uint8_t levelPrio[IRQ_LEVELS] = {
+  IRQ_PRIO_BUS, IRQ_PRIO_DMA, IRQ_PRIO_ACQUIRE, IRQ_PRIO_TELEMETRY, IRQ_PRIO_HOUSEKEEPING, IRQ_PRIO_TASKS,
+};
+
+static const char *const levelNames[IRQ_LEVELS] = {
+  "bus", "dma", "acquire", "telemetry", "housekeep", "tasks",
+};
+
+static volatile Irq_LatencyStats stats[IRQ_LEVELS];
+static volatile uint8_t probeLevel = 0;  // 下一次 update 所在的優先級
+
+void Irq_ProbeInit(void) {
+  __HAL_RCC_TIM3_CLK_ENABLE();
+
+  // APB1 timer clock is 72 MHz (PCLK1 x2), same as the sampler
+  IRQ_PROBE_TIM->CR1 = TIM_CR1_URS;  // only overflow raises the update interrupt
+  IRQ_PROBE_TIM->PSC = (HAL_RCC_GetPCLK1Freq() * 2 / (IRQ_PROBE_MHZ * 1000000U)) - 1;
+  IRQ_PROBE_TIM->ARR = IRQ_PROBE_PERIOD_US * IRQ_PROBE_MHZ - 1;
+  IRQ_PROBE_TIM->EGR = TIM_EGR_UG;  // latch PSC/ARR now
+  IRQ_PROBE_TIM->SR = 0;
+
+  Irq_ResetLatency();
+  probeLevel = IRQ_LEVEL_BUS;
+  HAL_NVIC_SetPriority(IRQ_PROBE_IRQn, levelPrio[IRQ_LEVEL_BUS], 0);
+  HAL_NVIC_EnableIRQ(IRQ_PROBE_IRQn);
+
+  IRQ_PROBE_TIM->CNT = 0;
+  IRQ_PROBE_TIM->DIER |= TIM_DIER_UIE;
+  IRQ_PROBE_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+/* TIM3 update: the counter restarted at the event, CNT is how long we waited */
+void Irq_ProbeHandler(void) {
+  uint32_t ticks = IRQ_PROBE_TIM->CNT;
+  if (!(IRQ_PROBE_TIM->SR & TIM_SR_UIF)) return;
+  IRQ_PROBE_TIM->SR = ~(uint32_t)TIM_SR_UIF;
+
+  volatile Irq_LatencyStats *s = &stats[probeLevel];
+  if (ticks > s->maxTicks) s->maxTicks = ticks;
+  s->sumTicks += ticks;
+  s->count++;
+
+  // Next period measures the next level; only this handler writes stats[]
+  probeLevel = (probeLevel + 1) % IRQ_LEVELS;
+  HAL_NVIC_SetPriority(IRQ_PROBE_IRQn, levelPrio[probeLevel], 0);
+}
+
+void Irq_GetLatency(Irq_Level level, Irq_LatencyStats *out) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *out = stats[level];
+  __set_PRIMASK(primask);
+}
+
+void Irq_ResetLatency(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (int i = 0; i < IRQ_LEVELS; i++) stats[i] = (Irq_LatencyStats){0};
+  __set_PRIMASK(primask);
+}
+
+// Worst-case and mean entry latency per preemption level, in ns
+HAL_StatusTypeDef Irq_Report(void) {
+  char buffer[320];
+  int len = 0;
+
+  for (int i = 0; i < IRQ_LEVELS; i++) {
+    Irq_LatencyStats s;
+    Irq_GetLatency((Irq_Level)i, &s);
+    uint32_t meanTicks = s.count ? (uint32_t)(s.sumTicks / s.count) : 0;
+    len += snprintf(&buffer[len], sizeof(buffer) - len, "irq %u %s max %lu ns mean %lu ns n %lu\r\n",
+                    levelPrio[i], levelNames[i], (unsigned long)(s.maxTicks * 1000 / IRQ_PROBE_MHZ),
+                    (unsigned long)(meanTicks * 1000 / IRQ_PROBE_MHZ), (unsigned long)s.count);
+    if (len >= (int)sizeof(buffer)) return HAL_ERROR;
+  }
+  return dataUart_Write((uint8_t *)buffer, len);
+}
+
+#endif  // IRQ_PROBE_ENABLED
@@ -0,0 +1,33 @@
+#include "latency.h"
+
+static const char *const stageNames[LATENCY_STAGES] = {
+  "dma", "process", "uart", "total",
+};
+
+static Latency_Stats stats[LATENCY_STAGES];
+static Hist_Report report = {"lat", " us", stageNames, stats, LATENCY_STAGES, -1};
+
+// Main loop only, all four stamps are Timebase_Us so wrap-around cancels out
+void Latency_Record(const IR_Frame *frame, uint32_t processed, uint32_t sent) {
+  if (frame == NULL) return;
+
+  Hist_Add(&stats[LATENCY_DMA], frame->dmaDone - frame->dmaStart, 0);
+  Hist_Add(&stats[LATENCY_PROCESS], processed - frame->dmaDone, 0);
+  Hist_Add(&stats[LATENCY_UART], sent - processed, 0);
+  Hist_Add(&stats[LATENCY_TOTAL], sent - frame->dmaStart, 0);
+}
+
+void Latency_Reset(void) {
+  for (int i = 0; i < LATENCY_STAGES; i++) {
+    stats[i] = (Latency_Stats){0};
+  }
+}
+
+const Latency_Stats *Latency_Get(Latency_Stage stage) { return &stats[stage]; }
+
+void Latency_RequestReport(void) { Hist_RequestReport(&report); }
+
+uint8_t Latency_ReportPending(void) { return Hist_ReportPending(&report); }
+
+// One stage per call, only when the whole line fits in the TX ring
+void Latency_Poll(void) { Hist_Poll(&report); }
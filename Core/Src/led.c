@@ -1,4 +1,19 @@
 #include "led.h"
+#include "profile.h"
+
+#define LED_PULSE_MS 10
+#define LED_HEARTBEAT_MS 1000
+#define LED_ERROR_ON_MS 150
+#define LED_ERROR_PERIOD_MS 400
+#define LED_ERROR_PAUSE_MS 1200
+
+static volatile LED_Pattern ledPattern = LED_PATTERN_OFF;
+static volatile uint8_t ledErrorCode = 0;
+static volatile uint16_t ledPulse = 0;   // 剩餘的 frame pulse 時間 (ms)
+static volatile uint16_t ledIdle = 0;    // 距離上一個 frame 的時間 (ms)
+static LED_Pattern ledShown = LED_PATTERN_OFF;  // pattern LED_Tick drew last
+static uint16_t ledPhase = 0;            // 目前 pattern 內的時間 (ms)
+static uint8_t ledState = 0;
 
 void LED_On(void) { HAL_GPIO_WritePin(GPIOC, GPIO_PIN_13, GPIO_PIN_RESET); }
 
@@ -13,4 +28,70 @@ void LED_Flash(uint32_t delay_ms, uint8_t times) {
     LED_Off();
     HAL_Delay(delay_ms);
   }
-}
\ No newline at end of file
+}
+
+// The phase restarts in LED_Tick when what it draws changes
+void LED_SetPattern(LED_Pattern pattern) { ledPattern = pattern; }
+
+void LED_SetErrorCode(uint8_t code) {
+  ledErrorCode = (code > LED_ERROR_MAX_CODE) ? LED_ERROR_MAX_CODE : code;
+}
+
+void LED_FrameEvent(void) {
+  ledPulse = LED_PULSE_MS;
+  ledIdle = 0;
+}
+
+void LED_Tick(void) {
+  PROFILE_BEGIN(PROFILE_LED_TICK);
+  uint8_t on = 0;
+
+  // Bus error code first, then the chosen pattern; no frames at all: heartbeat
+  LED_Pattern pattern = ledPattern;
+  if (ledIdle < LED_IDLE_MS) {
+    ledIdle++;
+  } else if (pattern == LED_PATTERN_FRAME || pattern == LED_PATTERN_BALL) {
+    pattern = LED_PATTERN_HEARTBEAT;
+  }
+  if (ledErrorCode) pattern = LED_PATTERN_ERROR;
+  if (pattern != ledShown) {
+    ledShown = pattern;
+    ledPhase = 0;
+  }
+
+  switch (pattern) {
+    case LED_PATTERN_HEARTBEAT:
+      // 亮 60 ms, 暗 140 ms, 亮 60 ms, 其餘時間熄滅
+      on = (ledPhase < 60) || (ledPhase >= 200 && ledPhase < 260);
+      if (++ledPhase >= LED_HEARTBEAT_MS) ledPhase = 0;
+      break;
+
+    case LED_PATTERN_FRAME:
+      if (ledPulse) {
+        ledPulse--;
+        on = 1;
+      }
+      break;
+
+    case LED_PATTERN_ERROR: {
+      uint16_t blinks = ledErrorCode * LED_ERROR_PERIOD_MS;  // at most 3600
+      on = (ledPhase < blinks) && (ledPhase % LED_ERROR_PERIOD_MS) < LED_ERROR_ON_MS;
+      if (++ledPhase >= blinks + LED_ERROR_PAUSE_MS) ledPhase = 0;
+      break;
+    }
+
+    case LED_PATTERN_BALL:
+      on = 1;
+      break;
+
+    default:
+      break;
+  }
+
+  // Only touch the pin on a change
+  if (on != ledState) {
+    ledState = on;
+    if (on) LED_On(); else LED_Off();
+  }
+  PROFILE_END(PROFILE_LED_TICK);
+}
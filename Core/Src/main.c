@@ -28,17 +28,38 @@
 /* USER CODE BEGIN Includes */
 #include "i2c_master.h"
 #include "data_uart.h"
+#include "telemetry.h"
+#include "sampler.h"
 #include "led.h"
 #include "ir.h"
+#include "profile.h"
+#include "latency.h"
+#include "pipeline.h"
+#include "sched.h"
+#include "idle.h"
+#include "irq.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
+// Scheduler priorities, 0 runs first
+enum { TASK_FRAME = 0, TASK_COMMAND, TASK_SERVICE };
 
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+// Slave sample rate; the default keeps the sweep rate at SAMPLER_MIN_HZ for any batch size
+#ifndef IR_SAMPLE_RATE_HZ
+#define IR_SAMPLE_RATE_HZ (SAMPLER_MIN_HZ * IR_BATCH_SAMPLES)
+#endif
+#define REPORT_PERIOD_MS 1000
+
+// Batch reads: the slaves sample at IR_SAMPLE_RATE_HZ, TIM2 drains them K at a time
+#define IR_SWEEP_RATE_HZ (IR_SAMPLE_RATE_HZ / IR_BATCH_SAMPLES)
+#if IR_SWEEP_RATE_HZ < SAMPLER_MIN_HZ || IR_SWEEP_RATE_HZ > SAMPLER_MAX_HZ
+#error "IR_SAMPLE_RATE_HZ / IR_BATCH_SAMPLES is outside SAMPLER_MIN_HZ .. SAMPLER_MAX_HZ"
+#endif
 
 /* USER CODE END PD */
 
@@ -50,6 +71,9 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+static I2C_ScanState busScan[2];
+static uint8_t driverCompare;  // 'd' waiting for the buses
+static uint32_t lastReportTime;
 
 /* USER CODE END PV */
 
@@ -61,6 +85,169 @@ void SystemClock_Config(void);
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+// Full address scan of both buses in the background, reported when done
+static void StartBusScan(void)
+{
+  I2C_ScanStart(&busScan[0], &hi2c1);
+  I2C_ScanStart(&busScan[1], &hi2c2);
+}
+
+// One probe per bus per call, only between sweeps
+static void PollBusScan(void)
+{
+  for (int i = 0; i < 2; i++) {
+    if (!I2C_ScanBusy(&busScan[i]) || !IR_ClaimBus()) continue;
+    I2C_ScanStep(&busScan[i]);
+    IR_ReleaseBus();
+    if (!I2C_ScanBusy(&busScan[i])) I2C_ScanReport(&busScan[i]);
+  }
+}
+
+// HAL vs LL cost of one SLAVE_1 read, between sweeps
+static void PollDriverCompare(void)
+{
+#if PROFILE_ENABLED
+  if (!driverCompare || !IR_ClaimBus()) return;
+  driverCompare = 0;
+  I2C_DriverReport(&hi2c1, SLAVE_1_ADDR, IR_BUFFER_SIZE);
+  IR_ReleaseBus();
+#endif
+}
+
+// Service task ticks every 1 ms while it has something to watch, see ServiceTask
+static void ServiceWake(void)
+{
+  Sched_SetTick(TASK_SERVICE, 1);
+}
+
+// Single-byte commands on USART2: 'p' dump profile, 'l' frame latency,
+// 'e' I2C error counters, 's' rescan, 't' task stats, 'c' CPU load,
+// 'i' interrupt latency per priority level, 'd' HAL vs LL read cost (DEBUG),
+// 'r' reset statistics
+static void CommandTask(Sched_Event event)
+{
+  int c;
+  while ((c = dataUart_ReadByte()) >= 0) {
+    switch (c) {
+      case 'p':
+        Profile_RequestDump();
+        ServiceWake();
+        break;
+      case 'l':
+        Latency_RequestReport();
+        ServiceWake();
+        break;
+      case 'e':
+        IR_ErrorReport();
+        break;
+      case 's':
+        StartBusScan();
+        ServiceWake();
+        break;
+      case 't':
+        Sched_Report();
+        break;
+      case 'c':
+        Idle_Report();
+        break;
+      case 'i':
+        Irq_Report();
+        break;
+#if PROFILE_ENABLED
+      case 'd':
+        driverCompare = 1;
+        ServiceWake();
+        break;
+#endif
+      case 'r':
+        Profile_Reset();
+        Latency_Reset();
+        Sched_ResetStats();
+        Irq_ResetLatency();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Frame published, or TX ring space back after back-pressure: drain the queue.
+// The next sweep is already on the bus and the last frame still leaving the UART
+static void FrameTask(Sched_Event event)
+{
+  while (IR_IsFrameReady() && Pipeline_CanProcess() && IR_AcquireFrame()) {
+    uint32_t start = Latency_Now();
+    LED_FrameEvent();  // Non-blocking pulse to indicate data received
+
+    // Display raw hex data for reference (uncomment if needed)
+    // DisplayRawHexData(ProcessBuffer[SLAVE_1], IR_BUFFER_SIZE);
+
+    updateValues();
+    uint32_t processed = Latency_Now();
+
+    // Decimal text or COBS binary frame, both slaves back to back
+    uint8_t payload[SLAVES_NO * IR_BUFFER_SIZE];
+    Telemetry_SendIRFrame(IR_CurrentFrame(), payload, IR_CopyPayload(payload), maxEye, maxValue);
+    uint32_t sent = Latency_Now();
+    Latency_Record(IR_CurrentFrame(), processed, sent);
+    Pipeline_Processed(IR_CurrentFrame(), start, sent);
+
+    // char outputStr[100];
+    // int len = snprintf(outputStr, sizeof(outputStr), "Max Eye: %d, Max Value: %d, Bearing: %u\r\n", maxEye, maxValue, ballBearing.angle);
+    // dataUart_Write((const uint8_t *)outputStr, len);
+  }
+}
+
+// On its tick, and right away on a bus error. The tick is 1 ms only while a
+// sweep, recovery, bus scan or report is in progress, else the report period
+static void ServiceTask(Sched_Event event)
+{
+  Profile_Poll();
+  Latency_Poll();
+
+  // Stuck reads and bus errors: bus clear, re-init, backoff
+  IR_Service();
+  if (event != SCHED_EV_I2C_ERROR) {
+    PollBusScan();
+    PollDriverCompare();
+
+    // Achieved rate, trigger jitter and bearing cost, text mode only
+    uint32_t currentTime = HAL_GetTick();
+    if (currentTime - lastReportTime >= REPORT_PERIOD_MS) {
+      lastReportTime = currentTime;
+      if (Telemetry_GetMode() == TELEMETRY_ASCII) {
+#if !IR_USE_DATA_READY
+        Sampler_Report();
+#endif
+        Bearing_Report(&ballBearing);
+        Pipeline_Report();
+        Idle_Report();
+      }
+    }
+  }
+
+  // Checked and set together: a sweep starting in between re-arms the fast tick
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint8_t busy = IR_ServiceDue() || I2C_ScanBusy(&busScan[0]) || I2C_ScanBusy(&busScan[1]) ||
+                 driverCompare || Profile_DumpPending() || Latency_ReportPending();
+  Sched_SetTick(TASK_SERVICE, busy ? 1 : REPORT_PERIOD_MS);
+  __set_PRIMASK(primask);
+}
+
+// Interrupt hooks: turn peripheral events into task events
+void IR_FrameReadyCallback(void) { Sched_Post(TASK_FRAME, SCHED_EV_FRAME_READY); }
+
+void IR_BusErrorCallback(void) { Sched_Post(TASK_SERVICE, SCHED_EV_I2C_ERROR); }
+
+void IR_SweepStartCallback(void) { ServiceWake(); }
+
+void dataUart_TxCallback(void)
+{
+  if (Pipeline_Resume()) Sched_Post(TASK_FRAME, SCHED_EV_UART_TX);
+}
+
+void dataUart_RxCallback(void) { Sched_Post(TASK_COMMAND, SCHED_EV_UART_RX); }
 
 /* USER CODE END 0 */
 
@@ -94,6 +281,7 @@ int main(void)
   MX_GPIO_Init();
   MX_DMA_Init();
   MX_I2C1_Init();
+  MX_I2C2_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
   // Ensure LED initial state is OFF
@@ -101,12 +289,18 @@ int main(void)
   
   // Initialize UART for data output
   dataUart_Init(&huart2);
+  dataUart_StartRx();
   
-  // Initialize IR module
-  IR_Init(&hi2c1, NULL);
+  // Initialize IR module, one bus per slave so both reads run in parallel
+  IR_Init(&hi2c1, &hi2c2);
+  IR_SetFrameCheck(IR_USE_FRAME_CHECK);
+  IR_SetRoi(IR_ROI_SPAN);
+  IR_SetBatch(IR_BATCH_SAMPLES, 1000000UL / IR_SAMPLE_RATE_HZ);
+  Bearing_Init();
   
   // Clear any possible residual states
   IR_ClearDataReady(SLAVE_1);
+  IR_ClearDataReady(SLAVE_2);
   
   // Brief delay for I2C slave device stabilization (if needed)
   HAL_Delay(10);  // Reduced from 100ms
@@ -119,40 +313,35 @@ int main(void)
   // Startup indicator: Flash 3 times to show system is ready
   LED_Flash(50, 3);
 
-  uint32_t lastRequestTime = HAL_GetTick();
-  const uint8_t dataFreq = 50; // in ms
-  
-  while (1) {
-    // Request IR data every 50ms
-    uint32_t currentTime = HAL_GetTick();
-    if (currentTime - lastRequestTime >= dataFreq && !IR_IsDataReady(SLAVE_1)) {
-      if (IR_ReadData(SLAVE_1) == HAL_OK) {
-        lastRequestTime = currentTime;
-      }
-      // If HAL_BUSY or HAL_ERROR, will retry on next loop
-    }
-
-    // Check if data is ready
-    if (IR_IsDataReady(SLAVE_1)) {  
-      LED_Flash(100, 1);  // Single flash to indicate data received
-
-      // Display raw hex data for reference (uncomment if needed)
-      // DisplayRawHexData(ProcessBuffer[SLAVE_1], IR_BUFFER_SIZE);
-
-      // Parse and display as decimal values (now with ambient light removed)
-      ParseAndDisplayIRData(ProcessBuffer[SLAVE_1], IR_BUFFER_SIZE);
+  // From here on the LED is driven by SysTick: a short pulse per frame, solid
+  // while updateValues sees the ball, IR_Fault blinks while a bus recovers
+  LED_SetPattern(LED_PATTERN_FRAME);
+
+#if IR_USE_DATA_READY
+  // Each slave's data-ready edge starts its own read, no fixed rate
+  IR_SetTrigger(IR_TRIGGER_DATA_READY);
+  MX_GPIO_DataReady_Init();
+#else
+  // TIM2 starts a sweep from its ISR, main only consumes complete frames
+  Sampler_Init(IR_SWEEP_RATE_HZ);
+  Sampler_Start();
+#endif
+
+  StartBusScan();
+
+  // From here on all work runs as PendSV tasks, posted from the interrupts
+  lastReportTime = HAL_GetTick();
+  Pipeline_Init();
+  Sched_Init();
+  Sched_AddTask(TASK_FRAME, "frame", FrameTask, 0);
+  Sched_AddTask(TASK_COMMAND, "command", CommandTask, 0);
+  Sched_AddTask(TASK_SERVICE, "service", ServiceTask, 1);  // boot scan running
+  Irq_ProbeInit();
+  Idle_Init();
 
-      // updateValues();
-      // char outputStr[100];
-      // int len = snprintf(outputStr, sizeof(outputStr), "Max Eye: %d, Max Value: %d\r\n", maxEye, maxValue);
-      // HAL_UART_Transmit(&huart2, (const uint8_t *)outputStr, len, HAL_MAX_DELAY);
-
-      LED_Off();
-      IR_ClearDataReady(SLAVE_1);
-    }
-    
-    // Small delay to avoid excessive CPU usage
-    HAL_Delay(1);
+  while (1) {
+    // Tasks run from PendSV when an event is posted, sleep until then
+    Idle_Sleep();
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -0,0 +1,84 @@
+#include "pipeline.h"
+#include "data_uart.h"
+#include "timebase.h"
+
+static Pipeline_Stats stats;
+static uint32_t windowStart = 0;
+static uint32_t emitBase = 0;      // dataUart busy µs at window start
+static uint32_t lastDmaStart = 0;  // batch frames share one transfer, count it once
+static volatile uint8_t waiting = 0;  // a ready frame is held back for TX space
+
+static void Pipeline_NewWindow(void) {
+  stats = (Pipeline_Stats){0};
+  windowStart = Timebase_Us();
+  emitBase = dataUart_GetBusyUs();
+}
+
+void Pipeline_Init(void) {
+  Pipeline_NewWindow();
+  lastDmaStart = 0;
+  waiting = 0;
+}
+
+// Flag first: a TX completion between the check and the return still resumes
+uint8_t Pipeline_CanProcess(void) {
+  waiting = 1;
+  if (dataUart_TxSpace() >= PIPE_EMIT_RESERVE) {
+    waiting = 0;
+    return 1;
+  }
+  if (IR_IsFrameReady()) {
+    stats.stalls++;
+  } else {
+    waiting = 0;
+  }
+  return 0;
+}
+
+// TX interrupt: 1 once a held-back frame fits, then the consumer is re-posted
+uint8_t Pipeline_Resume(void) {
+  if (!waiting || dataUart_TxSpace() < PIPE_EMIT_RESERVE) return 0;
+  waiting = 0;
+  return 1;
+}
+
+// start..end = the frame's time in the main loop, after IR_AcquireFrame
+void Pipeline_Processed(const IR_Frame *frame, uint32_t start, uint32_t end) {
+  stats.frames++;
+  stats.busyUs[PIPE_PROCESS] += end - start;
+  if (frame->dmaStart != lastDmaStart) {
+    stats.busyUs[PIPE_ACQUIRE] += frame->dmaDone - frame->dmaStart;
+    lastDmaStart = frame->dmaStart;
+  }
+
+  uint8_t depth = IR_QueueDepth();
+  if (depth > stats.queueMax) stats.queueMax = depth;
+  uint16_t pending = dataUart_TxPending();
+  if (pending > stats.txMax) stats.txMax = pending;
+}
+
+void Pipeline_GetStats(Pipeline_Stats *out) {
+  *out = stats;
+  out->busyUs[PIPE_EMIT] = dataUart_GetBusyUs() - emitBase;
+  out->windowUs = Timebase_Us() - windowStart;
+}
+
+static uint32_t Pipeline_Percent(uint32_t busy, uint32_t window) {
+  return window ? (uint32_t)((uint64_t)busy * 100 / window) : 0;
+}
+
+HAL_StatusTypeDef Pipeline_Report(void) {
+  Pipeline_Stats s;
+  Pipeline_GetStats(&s);
+
+  char buffer[128];
+  int len = snprintf(buffer, sizeof(buffer),
+                     "pipe acq %lu%% proc %lu%% emit %lu%% frames %lu stall %lu qmax %u txmax %u\r\n",
+                     (unsigned long)Pipeline_Percent(s.busyUs[PIPE_ACQUIRE], s.windowUs),
+                     (unsigned long)Pipeline_Percent(s.busyUs[PIPE_PROCESS], s.windowUs),
+                     (unsigned long)Pipeline_Percent(s.busyUs[PIPE_EMIT], s.windowUs),
+                     (unsigned long)s.frames, (unsigned long)s.stalls, s.queueMax, s.txMax);
+
+  Pipeline_NewWindow();
+  return dataUart_Write((uint8_t *)buffer, len);
+}
@@ -0,0 +1,44 @@
+#include "profile.h"
+
+void Profile_EnableCycleCounter(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#if PROFILE_ENABLED
+
+static const char *const regionNames[PROFILE_REGIONS] = {
+  "i2c_start", "i2c_irq", "i2c_cb", "update", "uart_fmt", "led",
+};
+
+static Profile_Stats stats[PROFILE_REGIONS];
+static Hist_Report dump = {"prof", "", regionNames, stats, PROFILE_REGIONS, -1};
+
+// Called from both ISR and thread context, so update under PRIMASK
+void Profile_Record(Profile_Region region, uint32_t cycles) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  Hist_Add(&stats[region], cycles, PROFILE_BUCKET_SHIFT);
+  __set_PRIMASK(primask);
+}
+
+void Profile_Reset(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (int i = 0; i < PROFILE_REGIONS; i++) {
+    stats[i] = (Profile_Stats){0};
+  }
+  __set_PRIMASK(primask);
+}
+
+const Profile_Stats *Profile_Get(Profile_Region region) { return &stats[region]; }
+
+void Profile_RequestDump(void) { Hist_RequestReport(&dump); }
+
+uint8_t Profile_DumpPending(void) { return Hist_ReportPending(&dump); }
+
+// One region per call, only when the whole line fits in the TX ring
+void Profile_Poll(void) { Hist_Poll(&dump); }
+
+#endif  // PROFILE_ENABLED
@@ -0,0 +1,98 @@
+#include "sampler.h"
+#include "data_uart.h"
+#include "irq.h"
+
+static volatile uint16_t samplerRate = SAMPLER_MIN_HZ;
+
+// 統計視窗 (一秒 = samplerRate 個週期)
+static volatile uint16_t windowPeriods = 0;
+static volatile uint32_t windowFrames = 0;
+static volatile uint16_t windowJitterMin = 0xFFFF;
+static volatile uint16_t windowJitterMax = 0;
+static volatile Sampler_Stats samplerStats = {0};
+
+void Sampler_Init(uint16_t rate_hz) {
+  __HAL_RCC_TIM2_CLK_ENABLE();
+
+  // APB1 timer clock is 72 MHz (PCLK1 x2), prescale to 1 MHz
+  SAMPLER_TIM->CR1 = TIM_CR1_URS;  // only overflow raises the update interrupt
+  SAMPLER_TIM->PSC = (HAL_RCC_GetPCLK1Freq() * 2 / 1000000) - 1;
+  Sampler_SetRate(rate_hz);
+
+  HAL_NVIC_SetPriority(TIM2_IRQn, IRQ_PRIO_ACQUIRE, 0);
+  HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+void Sampler_SetRate(uint16_t rate_hz) {
+  if (rate_hz < SAMPLER_MIN_HZ) rate_hz = SAMPLER_MIN_HZ;
+  if (rate_hz > SAMPLER_MAX_HZ) rate_hz = SAMPLER_MAX_HZ;
+
+  samplerRate = rate_hz;
+  samplerStats.targetHz = rate_hz;
+  SAMPLER_TIM->ARR = (1000000U / rate_hz) - 1;
+  SAMPLER_TIM->EGR = TIM_EGR_UG;  // latch PSC/ARR now
+
+  windowPeriods = 0;
+  windowFrames = IR_GetSweepCount();
+}
+
+void Sampler_Start(void) {
+  SAMPLER_TIM->CNT = 0;
+  SAMPLER_TIM->SR = 0;
+  SAMPLER_TIM->DIER |= TIM_DIER_UIE;
+  SAMPLER_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+void Sampler_Stop(void) {
+  SAMPLER_TIM->CR1 &= ~TIM_CR1_CEN;
+  SAMPLER_TIM->DIER &= ~TIM_DIER_UIE;
+}
+
+void Sampler_GetStats(Sampler_Stats *stats) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = samplerStats;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef Sampler_Report(void) {
+  Sampler_Stats stats;
+  char buffer[96];
+
+  Sampler_GetStats(&stats);
+  int len = snprintf(buffer, sizeof(buffer),
+                     "Sampler: %u/%u Hz, jitter %u-%u us, skipped %lu\r\n",
+                     stats.achievedHz, stats.targetHz, stats.jitterMinUs,
+                     stats.jitterMaxUs, (unsigned long)stats.skipped);
+  return dataUart_Write((uint8_t *)buffer, len);
+}
+
+/* TIM2 update interrupt: one sweep over all slaves per period */
+void Sampler_IRQHandler(void) {
+  if (!(SAMPLER_TIM->SR & TIM_SR_UIF)) return;
+  SAMPLER_TIM->SR = ~(uint32_t)TIM_SR_UIF;
+
+  // Counter restarted at the update event, so CNT is the trigger latency
+  uint16_t latency = SAMPLER_TIM->CNT;
+
+  samplerStats.triggers++;
+  if (IR_StartSweep() == HAL_OK) {
+    if (latency < windowJitterMin) windowJitterMin = latency;
+    if (latency > windowJitterMax) windowJitterMax = latency;
+  } else {
+    samplerStats.skipped++;
+  }
+
+  // 每秒更新一次統計
+  if (++windowPeriods >= samplerRate) {
+    uint32_t frames = IR_GetSweepCount();
+    samplerStats.achievedHz = frames - windowFrames;
+    samplerStats.jitterMinUs = (windowJitterMin == 0xFFFF) ? 0 : windowJitterMin;
+    samplerStats.jitterMaxUs = windowJitterMax;
+
+    windowFrames = frames;
+    windowPeriods = 0;
+    windowJitterMin = 0xFFFF;
+    windowJitterMax = 0;
+  }
+}
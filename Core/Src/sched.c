@@ -0,0 +1,146 @@
+#include "sched.h"
+#include "data_uart.h"
+#include "irq.h"
+#include "timebase.h"
+
+#define QUEUE_MASK (SCHED_QUEUE_SIZE - 1)
+
+#if (SCHED_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "SCHED_QUEUE_SIZE must be a power of two"
+#endif
+
+typedef struct {
+  Sched_Handler handler;
+  const char *name;
+  uint32_t periodUs;
+  uint32_t nextUs;  // Timebase_Us() deadline of the next SCHED_EV_TICK
+  uint8_t events[SCHED_QUEUE_SIZE];
+  uint8_t head;  // ISR 寫入
+  uint8_t tail;  // dispatcher 讀取
+  Sched_TaskStats stats;
+} Sched_Task;
+
+static Sched_Task tasks[SCHED_MAX_TASKS];
+static volatile uint8_t readyMask = 0;  // bit per priority with queued events
+
+void Sched_Init(void) {
+  for (int i = 0; i < SCHED_MAX_TASKS; i++) tasks[i] = (Sched_Task){0};
+  readyMask = 0;
+  // Below every peripheral IRQ, tasks never delay an ISR; SysTick sits one
+  // level up so HAL timeouts keep counting inside a task
+  HAL_NVIC_SetPriority(PendSV_IRQn, IRQ_PRIO_TASKS, 0);
+}
+
+void Sched_AddTask(uint8_t prio, const char *name, Sched_Handler handler, uint16_t tick_ms) {
+  if (prio >= SCHED_MAX_TASKS) return;
+  tasks[prio].name = name;
+  tasks[prio].periodUs = tick_ms * 1000UL;
+  tasks[prio].nextUs = Timebase_Us() + tasks[prio].periodUs;
+  tasks[prio].handler = handler;
+}
+
+void Sched_SetTick(uint8_t prio, uint16_t tick_ms) {
+  if (prio >= SCHED_MAX_TASKS) return;
+  Sched_Task *task = &tasks[prio];
+  uint32_t periodUs = tick_ms * 1000UL;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (task->periodUs != periodUs) {
+    task->periodUs = periodUs;
+    task->nextUs = Timebase_Us() + periodUs;
+  }
+  __set_PRIMASK(primask);
+}
+
+uint8_t Sched_Post(uint8_t prio, Sched_Event event) {
+  if (prio >= SCHED_MAX_TASKS || tasks[prio].handler == NULL) return 0;
+  Sched_Task *task = &tasks[prio];
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint8_t i = task->tail; i != task->head; i = (i + 1) & QUEUE_MASK) {
+    if (task->events[i] == event) {
+      __set_PRIMASK(primask);
+      return 1;
+    }
+  }
+  if (((task->head + 1) & QUEUE_MASK) == task->tail) {
+    task->stats.dropped++;
+    __set_PRIMASK(primask);
+    return 0;
+  }
+  task->events[task->head] = event;
+  task->head = (task->head + 1) & QUEUE_MASK;
+  readyMask |= 1U << prio;
+  __set_PRIMASK(primask);
+
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+  return 1;
+}
+
+// Deadlines on the µs clock, checked every SysTick with half a tick of slack;
+// a late SysTick neither drifts the period nor queues a burst of ticks
+void Sched_Tick(void) {
+  uint32_t now = Timebase_Us() + SCHED_TICK_US / 2;
+  for (int prio = 0; prio < SCHED_MAX_TASKS; prio++) {
+    Sched_Task *task = &tasks[prio];
+    if (task->handler == NULL) continue;
+
+    // Sched_SetTick may change the period from a higher-priority ISR
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t due = task->periodUs != 0 && (int32_t)(now - task->nextUs) >= 0;
+    if (due) {
+      task->nextUs += task->periodUs;
+      if ((int32_t)(now - task->nextUs) >= 0) task->nextUs = now + task->periodUs;  // fell behind, re-phase
+    }
+    __set_PRIMASK(primask);
+    if (due) Sched_Post(prio, SCHED_EV_TICK);
+  }
+}
+
+// Highest ready priority first, one event per run
+void Sched_Dispatch(void) {
+  while (readyMask) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t prio = __builtin_ctz(readyMask);
+    Sched_Task *task = &tasks[prio];
+    Sched_Event event = (Sched_Event)task->events[task->tail];
+    task->tail = (task->tail + 1) & QUEUE_MASK;
+    if (task->tail == task->head) readyMask &= ~(1U << prio);
+    __set_PRIMASK(primask);
+
+    uint32_t start = DWT->CYCCNT;
+    task->handler(event);
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    task->stats.runs++;
+    if (cycles > task->stats.wcet) task->stats.wcet = cycles;
+  }
+}
+
+void Sched_GetStats(uint8_t prio, Sched_TaskStats *stats) {
+  if (prio < SCHED_MAX_TASKS) *stats = tasks[prio].stats;
+}
+
+void Sched_ResetStats(void) {
+  for (int prio = 0; prio < SCHED_MAX_TASKS; prio++) tasks[prio].stats = (Sched_TaskStats){0};
+}
+
+HAL_StatusTypeDef Sched_Report(void) {
+  char buffer[320];
+  int len = 0;
+
+  for (int prio = 0; prio < SCHED_MAX_TASKS; prio++) {
+    Sched_Task *task = &tasks[prio];
+    if (task->handler == NULL) continue;
+    uint32_t wcetUs = task->stats.wcet / (SystemCoreClock / 1000000);
+    len += snprintf(&buffer[len], sizeof(buffer) - len, "task %u %s runs %lu wcet %lu us drop %lu\r\n",
+                    prio, task->name, (unsigned long)task->stats.runs, (unsigned long)wcetUs,
+                    (unsigned long)task->stats.dropped);
+    if (len >= (int)sizeof(buffer)) return HAL_ERROR;
+  }
+  return dataUart_Write((uint8_t *)buffer, len);
+}
@@ -22,6 +22,12 @@
 #include "stm32f1xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "sampler.h"
+#include "led.h"
+#include "i2c_ll.h"
+#include "profile.h"
+#include "sched.h"
+#include "irq.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -58,6 +64,9 @@
 extern DMA_HandleTypeDef hdma_i2c1_rx;
 extern DMA_HandleTypeDef hdma_i2c1_tx;
 extern I2C_HandleTypeDef hi2c1;
+extern DMA_HandleTypeDef hdma_i2c2_rx;
+extern DMA_HandleTypeDef hdma_i2c2_tx;
+extern I2C_HandleTypeDef hi2c2;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
 
@@ -173,7 +182,7 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
-
+  Sched_Dispatch();
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -190,7 +199,8 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  LED_Tick();
+  Sched_Tick();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -201,6 +211,39 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f1xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles DMA1 channel4 global interrupt.
+  */
+void DMA1_Channel4_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel4_IRQn 0 */
+
+  /* USER CODE END DMA1_Channel4_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c2_tx);
+  /* USER CODE BEGIN DMA1_Channel4_IRQn 1 */
+
+  /* USER CODE END DMA1_Channel4_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 channel5 global interrupt.
+  */
+void DMA1_Channel5_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel5_IRQn 0 */
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c2)) {
+    I2C_LL_DMA_IRQHandler(&hi2c2);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
+  /* USER CODE END DMA1_Channel5_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c2_rx);
+  /* USER CODE BEGIN DMA1_Channel5_IRQn 1 */
+  PROFILE_END(PROFILE_I2C_IRQ);
+  /* USER CODE END DMA1_Channel5_IRQn 1 */
+}
+
 /**
   * @brief This function handles DMA1 channel6 global interrupt.
   */
@@ -221,11 +264,16 @@ void DMA1_Channel6_IRQHandler(void)
 void DMA1_Channel7_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA1_Channel7_IRQn 0 */
-
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c1)) {
+    I2C_LL_DMA_IRQHandler(&hi2c1);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
   /* USER CODE END DMA1_Channel7_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_i2c1_rx);
   /* USER CODE BEGIN DMA1_Channel7_IRQn 1 */
-
+  PROFILE_END(PROFILE_I2C_IRQ);
   /* USER CODE END DMA1_Channel7_IRQn 1 */
 }
 
@@ -235,11 +283,16 @@ void DMA1_Channel7_IRQHandler(void)
 void I2C1_EV_IRQHandler(void)
 {
   /* USER CODE BEGIN I2C1_EV_IRQn 0 */
-
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c1)) {
+    I2C_LL_EV_IRQHandler(&hi2c1);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
   /* USER CODE END I2C1_EV_IRQn 0 */
   HAL_I2C_EV_IRQHandler(&hi2c1);
   /* USER CODE BEGIN I2C1_EV_IRQn 1 */
-
+  PROFILE_END(PROFILE_I2C_IRQ);
   /* USER CODE END I2C1_EV_IRQn 1 */
 }
 
@@ -249,14 +302,57 @@ void I2C1_EV_IRQHandler(void)
 void I2C1_ER_IRQHandler(void)
 {
   /* USER CODE BEGIN I2C1_ER_IRQn 0 */
-
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c1)) {
+    I2C_LL_ER_IRQHandler(&hi2c1);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
   /* USER CODE END I2C1_ER_IRQn 0 */
   HAL_I2C_ER_IRQHandler(&hi2c1);
   /* USER CODE BEGIN I2C1_ER_IRQn 1 */
-
+  PROFILE_END(PROFILE_I2C_IRQ);
   /* USER CODE END I2C1_ER_IRQn 1 */
 }
 
+/**
+  * @brief This function handles I2C2 event interrupt.
+  */
+void I2C2_EV_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C2_EV_IRQn 0 */
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c2)) {
+    I2C_LL_EV_IRQHandler(&hi2c2);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
+  /* USER CODE END I2C2_EV_IRQn 0 */
+  HAL_I2C_EV_IRQHandler(&hi2c2);
+  /* USER CODE BEGIN I2C2_EV_IRQn 1 */
+  PROFILE_END(PROFILE_I2C_IRQ);
+  /* USER CODE END I2C2_EV_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C2 error interrupt.
+  */
+void I2C2_ER_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C2_ER_IRQn 0 */
+  PROFILE_BEGIN(PROFILE_I2C_IRQ);
+  if (I2C_LL_OWNS(&hi2c2)) {
+    I2C_LL_ER_IRQHandler(&hi2c2);
+    PROFILE_END(PROFILE_I2C_IRQ);
+    return;
+  }
+  /* USER CODE END I2C2_ER_IRQn 0 */
+  HAL_I2C_ER_IRQHandler(&hi2c2);
+  /* USER CODE BEGIN I2C2_ER_IRQn 1 */
+  PROFILE_END(PROFILE_I2C_IRQ);
+  /* USER CODE END I2C2_ER_IRQn 1 */
+}
+
 /**
   * @brief This function handles USART2 global interrupt.
   */
@@ -272,5 +368,38 @@ void USART2_IRQHandler(void)
 }
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief This function handles TIM2 global interrupt (acquisition trigger).
+  */
+void TIM2_IRQHandler(void)
+{
+  Sampler_IRQHandler();
+}
+
+#if IRQ_PROBE_ENABLED
+/**
+  * @brief This function handles TIM3 global interrupt (latency probe).
+  */
+void TIM3_IRQHandler(void)
+{
+  Irq_ProbeHandler();
+}
+#endif
+
+/**
+  * @brief This function handles EXTI line0 interrupt (slave 1 data ready).
+  */
+void EXTI0_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(IR_DRDY1_Pin);
+}
+
+/**
+  * @brief This function handles EXTI line1 interrupt (slave 2 data ready).
+  */
+void EXTI1_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(IR_DRDY2_Pin);
+}
 
 /* USER CODE END 1 */
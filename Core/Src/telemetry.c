@@ -0,0 +1,80 @@
+#include "telemetry.h"
+#include "checksum.h"
+#include "profile.h"
+#include <string.h>
+
+static Telemetry_Mode telemetryMode = TELEMETRY_DEFAULT_MODE;
+
+void Telemetry_SetMode(Telemetry_Mode mode) { telemetryMode = mode; }
+
+Telemetry_Mode Telemetry_GetMode(void) { return telemetryMode; }
+
+// COBS: 把所有 0x00 移除, 讓 0x00 只出現在封包結尾 (接收端可隨時重新同步)
+// dst must hold size + size / 254 + 1 bytes, returns encoded length
+uint16_t Telemetry_COBSEncode(const uint8_t *src, uint16_t size, uint8_t *dst) {
+  uint16_t codePos = 0;
+  uint16_t out = 1;
+  uint8_t code = 1;
+
+  for (uint16_t i = 0; i < size; i++) {
+    if (src[i] == 0) {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      if (++code == 0xFF) {
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codePos] = code;
+  return out;
+}
+
+// Sweep number and start time of the IR frame itself, not of the send
+static HAL_StatusTypeDef Telemetry_SendBinary(const IR_Frame *ir, uint8_t *data, uint16_t size, uint8_t eye,
+                                              uint16_t value) {
+  uint8_t frame[TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + 2];
+  uint8_t encoded[sizeof(frame) + 2];
+  uint32_t timestamp = ir->timestamp;
+
+  if (size > TELEMETRY_MAX_PAYLOAD) size = TELEMETRY_MAX_PAYLOAD;
+
+  frame[0] = TELEMETRY_TYPE_IR;
+  frame[1] = (uint8_t)ir->seq;
+  frame[2] = timestamp & 0xFF;
+  frame[3] = (timestamp >> 8) & 0xFF;
+  frame[4] = (timestamp >> 16) & 0xFF;
+  frame[5] = timestamp >> 24;
+  frame[6] = eye;
+  frame[7] = value & 0xFF;
+  frame[8] = value >> 8;
+  memcpy(&frame[TELEMETRY_HEADER_SIZE], data, size);
+
+  uint16_t len = TELEMETRY_HEADER_SIZE + size;
+  uint16_t crc = Checksum_CRC16(CRC16_INIT, frame, len);
+  frame[len++] = crc & 0xFF;
+  frame[len++] = crc >> 8;
+
+  len = Telemetry_COBSEncode(frame, len, encoded);
+  encoded[len++] = 0x00;  // 封包分隔符
+  return dataUart_Write(encoded, len);
+}
+
+HAL_StatusTypeDef Telemetry_SendIRFrame(const IR_Frame *frame, uint8_t *data, uint16_t size, uint8_t eye,
+                                        uint16_t value) {
+  if (frame == NULL || data == NULL) return HAL_ERROR;
+
+  HAL_StatusTypeDef status;
+  PROFILE_BEGIN(PROFILE_UART_FORMAT);
+  if (telemetryMode == TELEMETRY_BINARY) {
+    status = Telemetry_SendBinary(frame, data, size, eye, value);
+  } else {
+    status = ParseAndDisplayIRData(data, size);
+  }
+  PROFILE_END(PROFILE_UART_FORMAT);
+  return status;
+}
@@ -0,0 +1,68 @@
+#include "timebase.h"
+
+static volatile uint32_t tickMs = 0;  // HAL_GetTick()
+static volatile uint32_t tickUs = 0;  // Timebase_Us() at the last whole ms
+
+// TIMxCLK = PCLK1, or PCLK1 x2 once the APB1 prescaler divides
+static uint32_t Timebase_TimerClock(void) {
+  uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+  return (RCC->CFGR & RCC_CFGR_PPRE1_2) ? pclk1 * 2 : pclk1;
+}
+
+void Timebase_Init(void) {
+  __HAL_RCC_TIM1_CLK_ENABLE();
+  __HAL_RCC_TIM4_CLK_ENABLE();
+  TIMEBASE_TIM_LO->CR1 = 0;
+  TIMEBASE_TIM_HI->CR1 = 0;
+
+  // TIM1: external clock mode 1 on ITR3 = TIM4 TRGO, one count per TIM4 wrap
+  TIMEBASE_TIM_HI->PSC = 0;
+  TIMEBASE_TIM_HI->ARR = 0xFFFF;
+  TIMEBASE_TIM_HI->SMCR = TIM_SMCR_TS_1 | TIM_SMCR_TS_0 | TIM_SMCR_SMS;
+  TIMEBASE_TIM_HI->EGR = TIM_EGR_UG;
+
+  // TIM4: 1 MHz, TRGO on update
+  TIMEBASE_TIM_LO->PSC = Timebase_TimerClock() / 1000000 - 1;
+  TIMEBASE_TIM_LO->ARR = 0xFFFF;
+  TIMEBASE_TIM_LO->CR2 = TIM_CR2_MMS_1;
+  TIMEBASE_TIM_LO->EGR = TIM_EGR_UG;  // latch PSC now, TIM1 is still stopped
+
+  TIMEBASE_TIM_HI->CNT = 0;
+  TIMEBASE_TIM_LO->CNT = 0;
+  TIMEBASE_TIM_HI->CR1 = TIM_CR1_CEN;
+  TIMEBASE_TIM_LO->CR1 = TIM_CR1_CEN;
+}
+
+// HAL_Init and HAL_RCC_ClockConfig call this; the second call re-derives the
+// 1 MHz prescaler for the new clock, the ms count carries on
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  (void)HAL_GetTick();
+  Timebase_Init();
+  tickUs = 0;
+  __set_PRIMASK(primask);
+
+  // SysTick only drives LED_Tick and Sched_Tick now
+  if (HAL_SYSTICK_Config(SystemCoreClock / (1000U / uwTickFreq)) > 0U) return HAL_ERROR;
+  if (TickPriority >= (1UL << __NVIC_PRIO_BITS)) return HAL_ERROR;
+  HAL_NVIC_SetPriority(SysTick_IRQn, TickPriority, 0U);
+  uwTickPrio = TickPriority;
+  return HAL_OK;
+}
+
+// SysTick: keeps the ms count well inside one wrap of the µs clock
+void HAL_IncTick(void) { (void)HAL_GetTick(); }
+
+// Follows the µs clock, so HAL timeouts also advance inside ISRs that
+// outrank SysTick
+uint32_t HAL_GetTick(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t ms = (Timebase_Us() - tickUs) / 1000;
+  tickUs += ms * 1000;
+  tickMs += ms;
+  uint32_t now = tickMs;
+  __set_PRIMASK(primask);
+  return now;
+}
@@ -21,7 +21,7 @@
 #include "usart.h"
 
 /* USER CODE BEGIN 0 */
-
+#include "irq.h"
 /* USER CODE END 0 */
 
 UART_HandleTypeDef huart2;
@@ -84,10 +84,11 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
     /* USART2 interrupt Init */
-    HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+    HAL_NVIC_SetPriority(USART2_IRQn, 3, 0);
     HAL_NVIC_EnableIRQ(USART2_IRQn);
   /* USER CODE BEGIN USART2_MspInit 1 */
-
+    // irq.h owns the level, the literal above is CubeMX's copy (.ioc)
+    HAL_NVIC_SetPriority(USART2_IRQn, IRQ_PRIO_TELEMETRY, 0);
   /* USER CODE END USART2_MspInit 1 */
   }
 }
@@ -0,0 +1,32 @@
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include "stm32f1xx_hal.h"
+
+// Test controls for the fake HAL, the "hardware" side of each peripheral
+void fake_Reset(void);
+// TIM1:TIM4 µs clock, restarted at 0 by fake_Reset; HAL_GetTick (timebase.c)
+// follows it, counting on from where the previous test left it
+void fake_SetTick(uint32_t tick);  // µs clock to tick ms after fake_Reset
+void fake_SetUs(uint32_t us);
+void fake_AddUs(uint32_t us);
+void fake_SetSleep(uint32_t cycles);  // length of the next __WFI()
+uint32_t fake_NVIC_Priority(IRQn_Type IRQn);  // last preemption level set
+
+// Finish the DMA read in flight on hi2c with data, then run the HAL callback
+void fake_I2C_Complete(I2C_HandleTypeDef *hi2c, const uint8_t *data, uint16_t size);
+void fake_I2C_Fail(I2C_HandleTypeDef *hi2c, uint32_t error);
+uint32_t fake_I2C_ReadCount(void);
+uint32_t fake_I2C_RecoveryCount(void);
+
+// Finish the UART IT transfer in flight, appending its bytes to the capture
+uint8_t fake_UART_Complete(UART_HandleTypeDef *huart);
+void fake_UART_Drain(UART_HandleTypeDef *huart);
+const uint8_t *fake_UART_Output(uint32_t *size);
+void fake_UART_ClearOutput(void);
+// Deliver one received byte to the pending IT receive, 0 if none is armed
+uint8_t fake_UART_Receive(UART_HandleTypeDef *huart, uint8_t byte);
+
+uint8_t fake_LED_IsOn(void);
+
+#endif  // FAKE_HAL_H
@@ -0,0 +1,212 @@
+/*
+ * Minimal stand-in for the STM32F1 HAL so the IR pipeline builds on the host.
+ * Only what Core/Src/{ir,data_uart,led,telemetry,bearing,checksum}.c use.
+ */
+#ifndef STM32F1XX_HAL_H
+#define STM32F1XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+typedef enum { HAL_OK = 0x00U, HAL_ERROR = 0x01U, HAL_BUSY = 0x02U, HAL_TIMEOUT = 0x03U } HAL_StatusTypeDef;
+
+/* Core --------------------------------------------------------------------*/
+typedef struct {
+  volatile uint32_t CTRL;
+  volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+  volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern uint32_t SystemCoreClock;
+extern DWT_Type fake_DWT;
+extern CoreDebug_Type fake_CoreDebug;
+
+#define DWT (&fake_DWT)
+#define CoreDebug (&fake_CoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+typedef struct {
+  volatile uint32_t ICSR;
+} SCB_Type;
+
+extern SCB_Type fake_SCB;
+
+#define SCB (&fake_SCB)
+#define SCB_ICSR_PENDSVSET_Msk (1UL << 28)
+
+typedef enum { PendSV_IRQn = -2, SysTick_IRQn = -1, TIM3_IRQn = 29 } IRQn_Type;
+
+#define TICK_INT_PRIORITY 14U
+#define __NVIC_PRIO_BITS 4U
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+
+typedef struct {
+  volatile uint32_t CTRL;
+  volatile uint32_t LOAD;
+  volatile uint32_t VAL;
+} SysTick_Type;
+
+extern SysTick_Type fake_SysTick;
+
+#define SysTick (&fake_SysTick)
+
+uint32_t HAL_SYSTICK_Config(uint32_t TicksNumb);
+
+// Sleeps for the cycles set with fake_SetSleep, SysTick counts down meanwhile
+void fake_WFI(void);
+#define __WFI() fake_WFI()
+
+extern uint32_t fake_PRIMASK;
+
+static inline void __disable_irq(void) { fake_PRIMASK = 1; }
+static inline void __enable_irq(void) { fake_PRIMASK = 0; }
+static inline uint32_t __get_PRIMASK(void) { return fake_PRIMASK; }
+static inline void __set_PRIMASK(uint32_t primask) { fake_PRIMASK = primask; }
+static inline void __DMB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+// HAL_InitTick / HAL_IncTick / HAL_GetTick come from Core/Src/timebase.c
+extern uint32_t uwTickPrio;
+extern uint32_t uwTickFreq;  // ms per SysTick
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+/* RCC / TIM ---------------------------------------------------------------*/
+typedef struct {
+  volatile uint32_t CFGR;
+} RCC_TypeDef;
+
+extern RCC_TypeDef fake_RCC;
+
+#define RCC (&fake_RCC)
+#define RCC_CFGR_PPRE1_2 (1UL << 10)
+
+typedef struct {
+  volatile uint32_t CR1;
+  volatile uint32_t CR2;
+  volatile uint32_t SMCR;
+  volatile uint32_t DIER;
+  volatile uint32_t SR;
+  volatile uint32_t EGR;
+  volatile uint32_t CNT;
+  volatile uint32_t PSC;
+  volatile uint32_t ARR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef fake_TIM1;
+extern TIM_TypeDef fake_TIM3;
+extern TIM_TypeDef fake_TIM4;
+
+#define TIM1 (&fake_TIM1)
+#define TIM3 (&fake_TIM3)
+#define TIM4 (&fake_TIM4)
+#define TIM_CR1_CEN (1UL << 0)
+#define TIM_CR1_URS (1UL << 2)
+#define TIM_DIER_UIE (1UL << 0)
+#define TIM_SR_UIF (1UL << 0)
+#define TIM_EGR_UG (1UL << 0)
+#define TIM_CR2_MMS_1 (1UL << 5)
+#define TIM_SMCR_SMS (7UL << 0)
+#define TIM_SMCR_TS_0 (1UL << 4)
+#define TIM_SMCR_TS_1 (1UL << 5)
+
+#define __HAL_RCC_TIM1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM3_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM4_CLK_ENABLE() ((void)0)
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+/* GPIO --------------------------------------------------------------------*/
+typedef enum { GPIO_PIN_RESET = 0U, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct {
+  uint32_t ODR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef fake_GPIOC;
+
+#define GPIOC (&fake_GPIOC)
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+/* I2C ---------------------------------------------------------------------*/
+typedef enum {
+  HAL_I2C_STATE_RESET = 0x00U,
+  HAL_I2C_STATE_READY = 0x20U,
+  HAL_I2C_STATE_BUSY_TX = 0x21U,
+  HAL_I2C_STATE_BUSY_RX = 0x22U,
+} HAL_I2C_StateTypeDef;
+
+typedef enum {
+  HAL_I2C_MODE_NONE = 0x00U,
+  HAL_I2C_MODE_MASTER = 0x10U,
+} HAL_I2C_ModeTypeDef;
+
+typedef struct __I2C_HandleTypeDef {
+  volatile HAL_I2C_StateTypeDef State;
+  volatile HAL_I2C_ModeTypeDef Mode;
+  volatile uint32_t ErrorCode;
+  uint16_t DevAddress;   // fake: address of the transfer in flight
+  uint8_t *pBuffPtr;     // fake: DMA destination of the transfer in flight
+  uint16_t XferSize;
+  uint32_t XferOptions;  // I2C_FIRST_FRAME / I2C_LAST_FRAME of a sequential transfer
+  uint8_t TxByte;        // fake: first byte of the last sequential transmit
+} I2C_HandleTypeDef;
+
+#define I2C_FIRST_FRAME 0x00000001U
+#define I2C_LAST_FRAME 0x00000020U
+
+#define HAL_I2C_ERROR_NONE 0x00000000U
+#define HAL_I2C_ERROR_BERR 0x00000001U
+#define HAL_I2C_ERROR_ARLO 0x00000002U
+#define HAL_I2C_ERROR_AF 0x00000004U
+#define HAL_I2C_ERROR_OVR 0x00000008U
+#define HAL_I2C_ERROR_DMA 0x00000010U
+#define HAL_I2C_ERROR_TIMEOUT 0x00000020U
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/* UART --------------------------------------------------------------------*/
+typedef enum {
+  HAL_UART_STATE_RESET = 0x00U,
+  HAL_UART_STATE_READY = 0x20U,
+  HAL_UART_STATE_BUSY_TX = 0x21U,
+  HAL_UART_STATE_BUSY_RX = 0x22U,
+} HAL_UART_StateTypeDef;
+
+typedef struct __UART_HandleTypeDef {
+  volatile HAL_UART_StateTypeDef gState;
+  volatile HAL_UART_StateTypeDef RxState;
+  const uint8_t *pTxBuffPtr;
+  uint16_t TxXferSize;
+  uint8_t *pRxBuffPtr;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+#endif /* STM32F1XX_HAL_H */
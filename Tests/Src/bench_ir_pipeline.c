@@ -0,0 +1,77 @@
+/*
+ * Host throughput benchmark for the processing path: sweep completion,
+ * frame hand-off, updateValues and telemetry formatting (ASCII and binary).
+ * Usage: bench_ir_pipeline [frames]
+ */
+#include "fake_hal.h"
+#include "ir.h"
+#include "data_uart.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static I2C_HandleTypeDef bus1;
+static I2C_HandleTypeDef bus2;
+static UART_HandleTypeDef uart;
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void setUp(void) {
+  fake_Reset();
+  memset(&bus1, 0, sizeof(bus1));
+  memset(&bus2, 0, sizeof(bus2));
+  memset(&uart, 0, sizeof(uart));
+  bus1.State = HAL_I2C_STATE_READY;
+  bus2.State = HAL_I2C_STATE_READY;
+  uart.gState = HAL_UART_STATE_READY;
+  IR_Init(&bus1, &bus2);
+  dataUart_Init(&uart);
+}
+
+static double run(long frames, int send, Telemetry_Mode mode) {
+  uint8_t payload[IR_BUFFER_SIZE];
+  uint32_t seed = 12345;
+
+  setUp();
+  Telemetry_SetMode(mode);
+
+  double start = nowNs();
+  for (long n = 0; n < frames; n++) {
+    for (int i = 0; i < IR_BUFFER_SIZE; i++) {
+      seed = seed * 1103515245 + 12345;
+      payload[i] = (uint8_t)(seed >> 16);
+    }
+
+    IR_StartSweep();
+    fake_I2C_Complete(&bus1, payload, sizeof(payload));
+    fake_I2C_Complete(&bus2, payload, sizeof(payload));
+
+    if (IR_AcquireFrame()) {
+      updateValues();
+      if (send) {
+        uint8_t frame[SLAVES_NO * IR_BUFFER_SIZE];
+        Telemetry_SendIRFrame(IR_CurrentFrame(), frame, IR_CopyPayload(frame), maxEye, maxValue);
+        fake_UART_Drain(&uart);
+        fake_UART_ClearOutput();
+      }
+    }
+  }
+  return (nowNs() - start) / frames;
+}
+
+int main(int argc, char **argv) {
+  long frames = (argc > 1) ? atol(argv[1]) : 200000;
+  if (frames <= 0) frames = 1;
+
+  printf("frames: %ld\n", frames);
+  printf("acquire + updateValues:          %8.1f ns/frame\n", run(frames, 0, TELEMETRY_ASCII));
+  printf("acquire + updateValues + ASCII:  %8.1f ns/frame\n", run(frames, 1, TELEMETRY_ASCII));
+  printf("acquire + updateValues + binary: %8.1f ns/frame\n", run(frames, 1, TELEMETRY_BINARY));
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include "fake_hal.h"
+#include <string.h>
+
+#define UART_CAPTURE_SIZE 8192
+
+uint32_t SystemCoreClock = 72000000;
+DWT_Type fake_DWT;
+CoreDebug_Type fake_CoreDebug;
+GPIO_TypeDef fake_GPIOC;
+uint32_t fake_PRIMASK;
+SCB_Type fake_SCB;
+SysTick_Type fake_SysTick;
+TIM_TypeDef fake_TIM1;
+TIM_TypeDef fake_TIM3;
+TIM_TypeDef fake_TIM4;
+RCC_TypeDef fake_RCC = {RCC_CFGR_PPRE1_2};  // APB1 = HCLK / 2, timers x2
+uint32_t uwTickPrio;
+uint32_t uwTickFreq = 1;
+
+#define NVIC_FAKE_IRQS 48  // 2 system handlers + device IRQs
+
+static uint32_t fakeSleep;
+static uint32_t nvicPriority[NVIC_FAKE_IRQS];
+static uint32_t i2cReads;
+static uint32_t i2cRecoveries;
+static uint8_t uartCapture[UART_CAPTURE_SIZE];
+static uint32_t uartCaptured;
+
+void fake_Reset(void) {
+  memset(&fake_DWT, 0, sizeof(fake_DWT));
+  memset(&fake_CoreDebug, 0, sizeof(fake_CoreDebug));
+  fake_GPIOC.ODR = GPIO_PIN_13;  // LED off (active low)
+  fake_PRIMASK = 0;
+  fake_SCB.ICSR = 0;
+  memset(&fake_TIM1, 0, sizeof(fake_TIM1));
+  memset(&fake_TIM3, 0, sizeof(fake_TIM3));
+  memset(&fake_TIM4, 0, sizeof(fake_TIM4));
+  memset(nvicPriority, 0, sizeof(nvicPriority));
+  // timebase.c restarts the µs clock at 0, the ms count carries on
+  HAL_InitTick(TICK_INT_PRIORITY);
+  fakeSleep = 0;
+  i2cReads = 0;
+  i2cRecoveries = 0;
+  uartCaptured = 0;
+}
+
+void fake_SetUs(uint32_t us) {
+  fake_TIM1.CNT = us >> 16;
+  fake_TIM4.CNT = us & 0xFFFF;
+}
+
+static uint32_t fake_Us(void) { return (fake_TIM1.CNT << 16) | fake_TIM4.CNT; }
+
+void fake_AddUs(uint32_t us) { fake_SetUs(fake_Us() + us); }
+
+void fake_SetTick(uint32_t tick) { fake_SetUs(tick * 1000); }
+
+void HAL_Delay(uint32_t Delay) { fake_AddUs(Delay * 1000); }
+
+uint32_t HAL_SYSTICK_Config(uint32_t TicksNumb) {
+  fake_SysTick.LOAD = TicksNumb - 1;
+  fake_SysTick.VAL = TicksNumb - 1;
+  return 0;
+}
+
+void fake_SetSleep(uint32_t cycles) { fakeSleep = cycles; }
+
+void fake_WFI(void) {
+  uint32_t period = fake_SysTick.LOAD + 1;
+  uint32_t elapsed = fakeSleep % period;
+  if (fake_SysTick.VAL >= elapsed) {
+    fake_SysTick.VAL -= elapsed;
+  } else {
+    fake_SysTick.VAL += period - elapsed;
+  }
+  fake_AddUs(fakeSleep / (SystemCoreClock / 1000000));
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+  nvicPriority[IRQn + 2] = PreemptPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {}
+
+uint32_t fake_NVIC_Priority(IRQn_Type IRQn) { return nvicPriority[IRQn + 2]; }
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return SystemCoreClock / 2; }
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (PinState == GPIO_PIN_SET) {
+    GPIOx->ODR |= GPIO_Pin;
+  } else {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) { GPIOx->ODR ^= GPIO_Pin; }
+
+uint8_t fake_LED_IsOn(void) { return (fake_GPIOC.ODR & GPIO_PIN_13) == 0; }
+
+/* I2C ---------------------------------------------------------------------*/
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c) { return hi2c->State; }
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size) {
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+  hi2c->State = HAL_I2C_STATE_BUSY_RX;
+  hi2c->Mode = HAL_I2C_MODE_MASTER;
+  hi2c->ErrorCode = 0;
+  hi2c->DevAddress = DevAddress;
+  hi2c->pBuffPtr = pData;
+  hi2c->XferSize = Size;
+  hi2c->XferOptions = 0;
+  i2cReads++;
+  return HAL_OK;
+}
+
+// Register write of a register read, one transaction with the receive after it
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions) {
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+  hi2c->State = HAL_I2C_STATE_BUSY_TX;
+  hi2c->Mode = HAL_I2C_MODE_MASTER;
+  hi2c->ErrorCode = 0;
+  hi2c->DevAddress = DevAddress;
+  hi2c->XferSize = Size;
+  hi2c->XferOptions = XferOptions;
+  hi2c->TxByte = pData[0];
+  i2cReads++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions) {
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+  hi2c->State = HAL_I2C_STATE_BUSY_RX;
+  hi2c->DevAddress = DevAddress;
+  hi2c->pBuffPtr = pData;
+  hi2c->XferSize = Size;
+  hi2c->XferOptions = XferOptions;
+  return HAL_OK;
+}
+
+// A register read sends its register first, then the receive completes
+void fake_I2C_Complete(I2C_HandleTypeDef *hi2c, const uint8_t *data, uint16_t size) {
+  if (hi2c->State == HAL_I2C_STATE_BUSY_TX) {
+    hi2c->State = HAL_I2C_STATE_READY;
+    HAL_I2C_MasterTxCpltCallback(hi2c);
+    if (hi2c->State != HAL_I2C_STATE_BUSY_RX) return;
+  }
+  if (size > hi2c->XferSize) size = hi2c->XferSize;
+  memcpy(hi2c->pBuffPtr, data, size);
+  hi2c->State = HAL_I2C_STATE_READY;
+  HAL_I2C_MasterRxCpltCallback(hi2c);
+}
+
+void fake_I2C_Fail(I2C_HandleTypeDef *hi2c, uint32_t error) {
+  hi2c->State = HAL_I2C_STATE_READY;
+  hi2c->ErrorCode = error;
+  HAL_I2C_ErrorCallback(hi2c);
+}
+
+uint32_t fake_I2C_ReadCount(void) { return i2cReads; }
+
+// Stands in for i2c_master.c: the bus clear is pin toggling, only the reset matters here
+HAL_StatusTypeDef I2C_BusRecover(I2C_HandleTypeDef *hi2c) {
+  hi2c->State = HAL_I2C_STATE_READY;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  i2cRecoveries++;
+  return HAL_OK;
+}
+
+uint32_t fake_I2C_RecoveryCount(void) { return i2cRecoveries; }
+
+/* UART --------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size) {
+  if (huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+  huart->pTxBuffPtr = pData;
+  huart->TxXferSize = Size;
+  return HAL_OK;
+}
+
+uint8_t fake_UART_Complete(UART_HandleTypeDef *huart) {
+  if (huart->gState != HAL_UART_STATE_BUSY_TX) return 0;
+
+  for (uint16_t i = 0; i < huart->TxXferSize && uartCaptured < UART_CAPTURE_SIZE; i++) {
+    uartCapture[uartCaptured++] = huart->pTxBuffPtr[i];
+  }
+  huart->gState = HAL_UART_STATE_READY;
+  HAL_UART_TxCpltCallback(huart);
+  return 1;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+  if (huart->RxState != HAL_UART_STATE_READY) return HAL_BUSY;
+
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  huart->pRxBuffPtr = pData;
+  return HAL_OK;
+}
+
+uint8_t fake_UART_Receive(UART_HandleTypeDef *huart, uint8_t byte) {
+  if (huart->RxState != HAL_UART_STATE_BUSY_RX) return 0;
+
+  *huart->pRxBuffPtr = byte;
+  huart->RxState = HAL_UART_STATE_READY;
+  HAL_UART_RxCpltCallback(huart);
+  return 1;
+}
+
+void fake_UART_Drain(UART_HandleTypeDef *huart) {
+  while (fake_UART_Complete(huart)) {
+  }
+}
+
+const uint8_t *fake_UART_Output(uint32_t *size) {
+  *size = uartCaptured;
+  return uartCapture;
+}
+
+void fake_UART_ClearOutput(void) { uartCaptured = 0; }
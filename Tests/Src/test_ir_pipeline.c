@@ -0,0 +1,1229 @@
+/*
+ * Host tests for the IR pipeline, run against the fake HAL in fake_hal.c.
+ * Build with the Host preset and run through ctest.
+ */
+#include "fake_hal.h"
+#include "ir.h"
+#include "data_uart.h"
+#include "telemetry.h"
+#include "checksum.h"
+#include "bearing.h"
+#include "led.h"
+#include "profile.h"
+#include "latency.h"
+#include "pipeline.h"
+#include "sched.h"
+#include "idle.h"
+#include "irq.h"
+#include "timebase.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(cond)                                                       \
+  do {                                                                    \
+    if (!(cond)) {                                                        \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+      failures++;                                                         \
+    }                                                                     \
+  } while (0)
+
+static int failures = 0;
+
+static I2C_HandleTypeDef bus1;
+static I2C_HandleTypeDef bus2;
+static UART_HandleTypeDef uart;
+
+static void setUp(I2C_HandleTypeDef *hi2c1, I2C_HandleTypeDef *hi2c2) {
+  fake_Reset();
+  memset(&bus1, 0, sizeof(bus1));
+  memset(&bus2, 0, sizeof(bus2));
+  memset(&uart, 0, sizeof(uart));
+  bus1.State = HAL_I2C_STATE_READY;
+  bus2.State = HAL_I2C_STATE_READY;
+  uart.gState = HAL_UART_STATE_READY;
+  uart.RxState = HAL_UART_STATE_READY;
+  IR_Init(hi2c1, hi2c2);
+  dataUart_Init(&uart);
+}
+
+// Slave payload: Vref word then 7 eye words, little-endian
+static void makePayload(uint8_t *out, uint16_t vref, const uint16_t *eyes) {
+  out[0] = vref & 0xFF;
+  out[1] = vref >> 8;
+  for (int i = 0; i < EYE_NUM; i++) {
+    out[2 + i * 2] = eyes[i] & 0xFF;
+    out[3 + i * 2] = eyes[i] >> 8;
+  }
+}
+
+static void test_combine_data(void) {
+  CHECK(combine_data(0x12, 0x34) == 0x1234);
+  CHECK(combine_data(0xFF, 0x00) == 0xFF00);
+}
+
+static void test_sweep_two_buses(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+  uint16_t eyesA[EYE_NUM] = {1, 2, 3, 4, 5, 6, 7};
+  uint16_t eyesB[EYE_NUM] = {8, 9, 10, 11, 12, 13, 14};
+
+  setUp(&bus1, &bus2);
+  makePayload(a, 1489, eyesA);
+  makePayload(b, 1490, eyesB);
+
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(fake_I2C_ReadCount() == 2);  // both buses start together
+  CHECK(IR_StartSweep() == HAL_BUSY);
+
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  CHECK(!IR_IsFrameReady());  // half a frame is never published
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_IsFrameReady());
+
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(memcmp(ProcessBuffer[SLAVE_1], a, IR_BUFFER_SIZE) == 0);
+  CHECK(memcmp(ProcessBuffer[SLAVE_2], b, IR_BUFFER_SIZE) == 0);
+  CHECK(IR_AcquireFrame() == 0);
+}
+
+static void test_sweep_shared_bus(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {1}, b[IR_BUFFER_SIZE] = {2};
+
+  setUp(&bus1, &bus1);
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(fake_I2C_ReadCount() == 1);
+  CHECK(bus1.DevAddress == (0x30 << 1));
+
+  // Completion of the first slave starts the second one from the callback
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  CHECK(fake_I2C_ReadCount() == 2);
+  CHECK(bus1.DevAddress == (0x31 << 1));
+  CHECK(!IR_IsFrameReady());
+
+  fake_I2C_Complete(&bus1, b, sizeof(b));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(ProcessBuffer[SLAVE_1][0] == 1);
+  CHECK(ProcessBuffer[SLAVE_2][0] == 2);
+}
+
+static void test_sweep_failed_slave_is_dropped(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+
+  setUp(&bus1, &bus1);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Fail(&bus1, HAL_I2C_ERROR_AF);
+  CHECK(fake_I2C_ReadCount() == 2);  // next slave still runs
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  CHECK(!IR_IsFrameReady());
+  CHECK(IR_StartSweep() == HAL_OK);  // and the next sweep can start
+}
+
+static void test_bus_error_recovery_and_backoff(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+  IR_ErrorStats errors;
+
+  setUp(&bus1, &bus2);
+  CHECK(!IR_ServiceDue());
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(IR_ServiceDue());  // reads on the bus, watch for a timeout
+  fake_I2C_Fail(&bus1, HAL_I2C_ERROR_BERR);
+  fake_I2C_Complete(&bus2, a, sizeof(a));
+  CHECK(IR_StartSweep() == HAL_BUSY);  // held until the bus is cleared
+  CHECK(IR_ServiceDue());
+
+  IR_Service();
+  CHECK(!IR_ServiceDue());
+  CHECK(fake_I2C_RecoveryCount() == 1);
+  IR_GetErrorStats(SLAVE_1, &errors);
+  CHECK(errors.busError == 1 && errors.recoveries == 1);
+  IR_GetErrorStats(SLAVE_2, &errors);
+  CHECK(errors.busError == 0 && errors.recoveries == 0);
+
+  // 1 ms backoff, then acquisition resumes
+  CHECK(IR_StartSweep() == HAL_BUSY);
+  fake_SetTick(1);
+  CHECK(IR_StartSweep() == HAL_OK);
+
+  // A read that never completes is a timeout, the next backoff doubles
+  fake_SetTick(10);
+  IR_Service();
+  CHECK(fake_I2C_RecoveryCount() == 3);  // both buses were in flight
+  IR_GetErrorStats(SLAVE_1, &errors);
+  CHECK(errors.timeout == 1 && errors.recoveries == 2);
+  fake_SetTick(11);
+  CHECK(IR_StartSweep() == HAL_BUSY);
+  fake_SetTick(12);
+  CHECK(IR_StartSweep() == HAL_OK);
+
+  // A complete frame resets the backoff; NACK alone needs no recovery
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, a, sizeof(a));
+  CHECK(IR_IsFrameReady());
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Fail(&bus2, HAL_I2C_ERROR_AF);
+  IR_Service();
+  CHECK(fake_I2C_RecoveryCount() == 3);
+  IR_GetErrorStats(SLAVE_2, &errors);
+  CHECK(errors.nack == 1);
+}
+
+static void test_recovery_spares_other_bus(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+
+  // Bus 1 wedges while bus 2 is still reading
+  setUp(&bus1, &bus2);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Fail(&bus1, HAL_I2C_ERROR_BERR);
+  IR_Service();
+  CHECK(fake_I2C_RecoveryCount() == 1);
+
+  // Bus 2's read is still owned by the sweep, no new sweep can start on it
+  fake_SetTick(5);
+  CHECK(bus2.State == HAL_I2C_STATE_BUSY_RX);
+  CHECK(IR_StartSweep() == HAL_BUSY);
+  CHECK(IR_ClaimBus() == 0);
+
+  // and still lands once it completes; the sweep itself was abandoned
+  fake_I2C_Complete(&bus2, a, sizeof(a));
+  CHECK(!IR_IsFrameReady());
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.State == HAL_I2C_STATE_BUSY_RX && bus2.State == HAL_I2C_STATE_BUSY_RX);
+}
+
+static void test_hotplug_detach_and_readmit(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+  IR_ErrorStats errors;
+
+  setUp(&bus1, &bus2);
+  memset(a, 0x11, sizeof(a));
+  memset(b, 0x22, sizeof(b));
+
+  // Slave 2 unplugged: the first misses drop the frame, then it is detached
+  for (int i = 0; i < IR_HOTPLUG_MISSES; i++) {
+    CHECK(IR_StartSweep() == HAL_OK);
+    fake_I2C_Complete(&bus1, a, sizeof(a));
+    CHECK(!IR_IsFrameReady());
+    fake_I2C_Fail(&bus2, HAL_I2C_ERROR_AF);
+  }
+  CHECK(IR_GetPresentMask() == (1U << SLAVE_1));
+  CHECK(IR_IsFrameReady());  // the last sweep already published without it
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->present == (1U << SLAVE_1));
+  CHECK(ProcessBuffer[SLAVE_2][0] == 0 && ProcessBuffer[SLAVE_2][IR_BUFFER_SIZE - 1] == 0);
+
+  // Between probes only slave 1 is read
+  uint32_t reads = fake_I2C_ReadCount();
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(fake_I2C_ReadCount() == reads + 1);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  CHECK(IR_AcquireFrame() == 1);
+
+  // Plugged back in, the next probe re-admits it
+  fake_SetTick(IR_HOTPLUG_PROBE_MS);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_GetPresentMask() == ((1U << SLAVE_1) | (1U << SLAVE_2)));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->present == ((1U << SLAVE_1) | (1U << SLAVE_2)));
+  CHECK(memcmp(ProcessBuffer[SLAVE_2], b, IR_BUFFER_SIZE) == 0);
+
+  IR_GetErrorStats(SLAVE_2, &errors);
+  CHECK(errors.detached == 1 && errors.attached == 1 && errors.nack == IR_HOTPLUG_MISSES);
+}
+
+static void test_claimed_bus_holds_sweeps(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+
+  setUp(&bus1, &bus2);
+  CHECK(IR_ClaimBus());
+  CHECK(IR_StartSweep() == HAL_BUSY);
+  IR_ReleaseBus();
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(!IR_ClaimBus());  // not while a sweep is on the bus
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, a, sizeof(a));
+  CHECK(IR_ClaimBus());
+  IR_ReleaseBus();
+}
+
+static void test_data_ready_trigger(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+
+  setUp(&bus1, &bus1);  // shared bus, the second read waits for the first
+  memset(a, 0x11, sizeof(a));
+  memset(b, 0x22, sizeof(b));
+  IR_SetTrigger(IR_TRIGGER_DATA_READY);
+  CHECK(IR_StartSweep() == HAL_BUSY);  // TIM2 no longer drives reads
+
+  HAL_GPIO_EXTI_Callback(IR_DRDY2_Pin);
+  CHECK(fake_I2C_ReadCount() == 1);
+  CHECK(bus1.DevAddress == (0x31 << 1));
+  HAL_GPIO_EXTI_Callback(IR_DRDY1_Pin);
+  CHECK(fake_I2C_ReadCount() == 1);  // queued behind slave 2
+  HAL_GPIO_EXTI_Callback(IR_DRDY2_Pin);  // already in this frame, ignored
+  fake_I2C_Complete(&bus1, b, sizeof(b));
+  CHECK(fake_I2C_ReadCount() == 2);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(memcmp(ProcessBuffer[SLAVE_1], a, IR_BUFFER_SIZE) == 0);
+  CHECK(memcmp(ProcessBuffer[SLAVE_2], b, IR_BUFFER_SIZE) == 0);
+
+  // A slave that stops signalling is missed per frame timeout, then detached
+  for (int i = 0; i < IR_HOTPLUG_MISSES; i++) {
+    fake_SetTick(100 * (i + 1));
+    HAL_GPIO_EXTI_Callback(IR_DRDY1_Pin);
+    fake_I2C_Complete(&bus1, a, sizeof(a));
+    CHECK(!IR_IsFrameReady());
+    fake_SetTick(100 * (i + 1) + IR_DRDY_TIMEOUT_MS + 1);
+    IR_Service();
+  }
+  CHECK(IR_GetPresentMask() == (1U << SLAVE_1));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->present == (1U << SLAVE_1));
+
+  IR_SetTrigger(IR_TRIGGER_TIMER);
+}
+
+// Checked frame: payload, sequence byte, CRC-8 over both
+static void makeCheckedFrame(uint8_t *out, uint8_t fill, uint8_t seq) {
+  memset(out, fill, IR_BUFFER_SIZE);
+  out[IR_FRAME_SEQ] = seq;
+  out[IR_FRAME_CRC] = Checksum_CRC8(CRC8_INIT, out, IR_FRAME_CRC) ^ CRC8_XOROUT;
+}
+
+static void test_frame_check_drops_bad_frames(void) {
+  uint8_t a[IR_FRAME_SIZE], b[IR_FRAME_SIZE];
+  IR_ErrorStats e;
+
+  setUp(&bus1, &bus2);
+  IR_SetFrameCheck(1);
+
+  // Good frames pass, the consumer sees the payload
+  makeCheckedFrame(a, 0x11, 7);
+  makeCheckedFrame(b, 0x22, 40);
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.XferSize == IR_FRAME_SIZE);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(ProcessBuffer[SLAVE_1][0] == 0x11 && ProcessBuffer[SLAVE_2][0] == 0x22);
+
+  // One flipped bit: the whole sweep is dropped
+  makeCheckedFrame(a, 0x33, 8);
+  a[3] ^= 0x04;
+  makeCheckedFrame(b, 0x44, 41);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(!IR_IsFrameReady());
+  IR_GetErrorStats(SLAVE_1, &e);
+  CHECK(e.crc == 1);
+  CHECK(IR_GetPresentMask() == 0x03);  // corrupt, not missing
+
+  // Same sequence again is a stale repeat; a skipped number is a gap
+  makeCheckedFrame(a, 0x55, 10);
+  makeCheckedFrame(b, 0x66, 41);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(!IR_IsFrameReady());
+  IR_GetErrorStats(SLAVE_1, &e);
+  CHECK(e.gap == 2);
+  IR_GetErrorStats(SLAVE_2, &e);
+  CHECK(e.duplicate == 1 && e.gap == 0);
+
+  // Sequence wraps from 255 to 0 without a gap
+  makeCheckedFrame(a, 0x77, 11);
+  makeCheckedFrame(b, 0x88, 255);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  makeCheckedFrame(a, 0x99, 12);
+  makeCheckedFrame(b, 0xAA, 0);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(ProcessBuffer[SLAVE_1][0] == 0x77 && ProcessBuffer[SLAVE_2][0] == 0x88);
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(ProcessBuffer[SLAVE_2][0] == 0xAA);
+  IR_GetErrorStats(SLAVE_2, &e);
+  CHECK(e.gap == 213);  // 41 -> 255 only
+
+  uint8_t payload[SLAVES_NO * IR_BUFFER_SIZE];
+  CHECK(IR_CopyPayload(payload) == sizeof(payload));
+  CHECK(payload[IR_BUFFER_SIZE - 1] == 0x99 && payload[IR_BUFFER_SIZE] == 0xAA);
+}
+
+static void test_roi_window_reads(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE], win[2 + 5 * 2];
+  uint16_t eyesA[EYE_NUM] = {10, 20, 30, 40, 50, 60, 70};
+  uint16_t eyesB[EYE_NUM] = {100, 200, 300, 900, 300, 200, 100};
+
+  setUp(&bus1, &bus2);
+  IR_SetRoi(2);
+
+  // First sweep is always full
+  makePayload(a, 1489, eyesA);
+  makePayload(b, 1490, eyesB);
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.State == HAL_I2C_STATE_BUSY_RX && bus1.XferSize == IR_BUFFER_SIZE);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->eyeMask == 0x3FFF);
+  updateValues();
+  CHECK(maxEye == 10);
+
+  // Eyes 8..12 all sit on SLAVE_2, SLAVE_1 is not read at all
+  uint32_t reads = fake_I2C_ReadCount();
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(fake_I2C_ReadCount() == reads + 1);
+  // Register byte by interrupt first, no blocking address phase
+  CHECK(bus2.State == HAL_I2C_STATE_BUSY_TX && bus2.TxByte == IR_REG_WINDOW(1, 5));
+  CHECK(bus2.XferOptions == I2C_FIRST_FRAME && fake_PRIMASK == 0);
+  uint16_t window[5] = {210, 310, 910, 310, 210};
+  win[0] = 1490 & 0xFF;
+  win[1] = 1490 >> 8;
+  for (int i = 0; i < 5; i++) {
+    win[2 + i * 2] = window[i] & 0xFF;
+    win[3 + i * 2] = window[i] >> 8;
+  }
+  fake_I2C_Complete(&bus2, win, sizeof(win));
+  CHECK(bus2.XferSize == sizeof(win) && bus2.XferOptions == I2C_LAST_FRAME);
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->eyeMask == 0x1F00);
+  CHECK(combine_data(ProcessBuffer[SLAVE_2][1], ProcessBuffer[SLAVE_2][0]) == 1490);
+  CHECK(ProcessBuffer[SLAVE_2][2] == 0 && ProcessBuffer[SLAVE_2][3] == 0);
+  CHECK(combine_data(ProcessBuffer[SLAVE_2][9], ProcessBuffer[SLAVE_2][8]) == 910);
+  CHECK(ProcessBuffer[SLAVE_1][2] == 0);
+  updateValues();
+  CHECK(maxEye == 10 && maxValue == 910);
+
+  // Window across the wrap: eyes 12,13 on SLAVE_2 and 0..2 on SLAVE_1
+  maxEye = 0;
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.TxByte == IR_REG_WINDOW(0, 3) && bus2.TxByte == IR_REG_WINDOW(5, 2));
+  fake_I2C_Complete(&bus1, win, 2 + 3 * 2);
+  fake_I2C_Complete(&bus2, win, 2 + 2 * 2);
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->eyeMask == 0x3007);
+
+  // Every IR_ROI_FULL_EVERY-th sweep reads everything again
+  for (int n = 3; n < IR_ROI_FULL_EVERY; n++) {
+    CHECK(IR_StartSweep() == HAL_OK);
+    CHECK(bus1.State == HAL_I2C_STATE_BUSY_TX);
+    fake_I2C_Complete(&bus1, win, 2 + 3 * 2);
+    fake_I2C_Complete(&bus2, win, 2 + 2 * 2);
+  }
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.State == HAL_I2C_STATE_BUSY_RX && bus1.XferSize == IR_BUFFER_SIZE);
+  CHECK(bus2.State == HAL_I2C_STATE_BUSY_RX);
+}
+
+static void test_batch_reads_unpack_samples(void) {
+  uint8_t a[3 * IR_BUFFER_SIZE], b[3 * IR_BUFFER_SIZE];
+  uint8_t ca[3 * IR_FRAME_SIZE], cb[3 * IR_FRAME_SIZE];
+  IR_ErrorStats e;
+
+  setUp(&bus1, &bus2);
+  IR_SetBatch(3, 2000);
+  for (int j = 0; j < 3; j++) {
+    memset(&a[j * IR_BUFFER_SIZE], 0x10 + j, IR_BUFFER_SIZE);
+    memset(&b[j * IR_BUFFER_SIZE], 0x20 + j, IR_BUFFER_SIZE);
+  }
+
+  // One transaction per slave carries all three samples
+  uint32_t sweeps = IR_GetSweepCount();
+  fake_SetTick(100);
+  CHECK(IR_StartSweep() == HAL_OK);
+  CHECK(bus1.State == HAL_I2C_STATE_BUSY_TX && bus1.TxByte == IR_REG_BATCH(3));
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  CHECK(bus1.XferSize == sizeof(a));
+  CHECK(!IR_IsFrameReady());
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_GetSweepCount() == sweeps + 3);
+
+  // Oldest first, back-dated by the 2 ms sample period (µs timestamps)
+  for (int j = 0; j < 3; j++) {
+    CHECK(IR_AcquireFrame() == 1);
+    CHECK(ProcessBuffer[SLAVE_1][0] == 0x10 + j && ProcessBuffer[SLAVE_2][15] == 0x20 + j);
+    CHECK(IR_CurrentFrame()->timestamp == (96 + (uint32_t)j * 2) * 1000);
+    CHECK(IR_CurrentFrame()->seq == sweeps + j);
+  }
+  CHECK(IR_AcquireFrame() == 0);
+
+  // A sample that fails its check on one slave is dropped on its own
+  IR_SetFrameCheck(1);
+  for (int j = 0; j < 3; j++) {
+    makeCheckedFrame(&ca[j * IR_FRAME_SIZE], 0x30 + j, j);
+    makeCheckedFrame(&cb[j * IR_FRAME_SIZE], 0x40 + j, 10 + j);
+  }
+  cb[IR_FRAME_SIZE + 4] ^= 0x80;
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, ca, sizeof(ca));
+  fake_I2C_Complete(&bus2, cb, sizeof(cb));
+  CHECK(bus2.XferSize == sizeof(cb));
+  IR_GetErrorStats(SLAVE_2, &e);
+  CHECK(e.crc == 1);
+  CHECK(IR_AcquireFrame() == 1 && ProcessBuffer[SLAVE_1][0] == 0x30);
+  CHECK(IR_AcquireFrame() == 1 && ProcessBuffer[SLAVE_1][0] == 0x32);
+  CHECK(IR_AcquireFrame() == 0);
+}
+
+static void test_save_data_one_frame(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+  uint8_t outA[IR_BUFFER_SIZE], outB[IR_BUFFER_SIZE];
+
+  setUp(&bus1, &bus2);
+  for (int n = 0; n < 2; n++) {
+    memset(a, 0x10 + n, sizeof(a));
+    memset(b, 0x20 + n, sizeof(b));
+    CHECK(IR_StartSweep() == HAL_OK);
+    fake_I2C_Complete(&bus1, a, sizeof(a));
+    fake_I2C_Complete(&bus2, b, sizeof(b));
+  }
+  CHECK(IR_QueueDepth() == 2);
+
+  // Both halves come from the same sweep, SLAVE_2 does not take the next one
+  CHECK(IR_SaveData(SLAVE_1, outA, sizeof(outA)) == 1);
+  CHECK(IR_SaveData(SLAVE_2, outB, sizeof(outB)) == 1);
+  CHECK(outA[0] == 0x10 && outB[0] == 0x20);
+  CHECK(IR_QueueDepth() == 2);
+
+  CHECK(IR_SaveData(SLAVE_1, outA, sizeof(outA)) == 1);
+  CHECK(IR_SaveData(SLAVE_2, outB, sizeof(outB)) == 1);
+  CHECK(outA[0] == 0x11 && outB[0] == 0x21);
+
+  // Queue empty: nothing new for either slave
+  CHECK(IR_SaveData(SLAVE_1, outA, sizeof(outA)) == 0);
+  CHECK(IR_SaveData(SLAVE_2, outB, sizeof(outB)) == 0);
+}
+
+static void test_queue_overwrite_accounting(void) {
+  uint8_t payload[IR_BUFFER_SIZE] = {0};
+  IR_QueueStats stats;
+  const int sweeps = IR_QUEUE_SIZE + 2;
+
+  setUp(&bus1, &bus2);
+  for (int n = 0; n < sweeps; n++) {
+    payload[0] = (uint8_t)n;
+    fake_SetTick(100 + n);
+    CHECK(IR_StartSweep() == HAL_OK);
+    fake_I2C_Complete(&bus1, payload, sizeof(payload));
+    fake_I2C_Complete(&bus2, payload, sizeof(payload));
+  }
+
+  IR_GetQueueStats(&stats);
+  CHECK(stats.produced == IR_QUEUE_SIZE - 1);
+  CHECK(stats.overwritten == (uint32_t)(sweeps - (IR_QUEUE_SIZE - 1)));
+
+  // The consumer catches up on everything that was queued, oldest first
+  for (int n = 0; n < IR_QUEUE_SIZE - 1; n++) {
+    CHECK(IR_AcquireFrame() == 1);
+    CHECK(ProcessBuffer[SLAVE_1][0] == n);
+    CHECK(IR_CurrentFrame()->timestamp == (uint32_t)(100 + n) * 1000);
+  }
+  CHECK(IR_AcquireFrame() == 0);
+
+  IR_GetQueueStats(&stats);
+  CHECK(stats.consumed == IR_QUEUE_SIZE - 1);
+}
+
+static void test_update_values_and_bearing(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+  uint16_t eyesA[EYE_NUM] = {0, 0, 500, 1000, 500, 0, 0};
+  uint16_t eyesB[EYE_NUM] = {0};
+
+  setUp(&bus1, &bus2);
+  makePayload(a, 1489, eyesA);
+  makePayload(b, 1489, eyesB);
+  IR_StartSweep();
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  CHECK(IR_AcquireFrame() == 1);
+
+  updateValues();
+  CHECK(maxEye == 3);
+  CHECK(maxValue == 1000);
+
+  // Symmetric neighbours, so the bearing sits on eye 3 (3 * 360 / 14 = 77 deg)
+  uint16_t expected = (uint16_t)(3 * 65536 / BEARING_EYES);
+  int diff = (int16_t)(ballBearing.angle - expected);
+  CHECK(diff > -40 && diff < 40);
+  CHECK(ballBearing.magnitude > 1000);
+}
+
+// 16 BAM = 0.09 degrees, the CORDIC table rounding error
+static void test_bearing_atan2(void) {
+  uint32_t mag;
+
+  int diff = (int16_t)(Bearing_Atan2(0, 1000, &mag) - 0);
+  CHECK(diff > -16 && diff < 16);
+  CHECK(mag >= 998 && mag <= 1002);
+  diff = (int16_t)(Bearing_Atan2(1000, 0, NULL) - 0x4000);
+  CHECK(diff > -16 && diff < 16);
+  diff = (int16_t)(Bearing_Atan2(-1000, -1000, NULL) - 0xA000);
+  CHECK(diff > -16 && diff < 16);
+  CHECK(Bearing_Atan2(-1000, -1000, &mag) && mag >= 1412 && mag <= 1416);
+}
+
+static void test_adc_to_mv(void) {
+  CHECK(IR_ADC_to_mV(1489, 1489) == IR_VREFINT_MV);
+  CHECK(IR_Vdda_mV(1489) == 3300);
+  CHECK(IR_ADC_to_mV(2048, 1489) == 1651);  // 1650.6 rounded
+  CHECK(IR_ADC_to_mV(100, 0) == 0);
+}
+
+static void test_crc16(void) {
+  CHECK(Checksum_CRC16(CRC16_INIT, (const uint8_t *)"123456789", 9) == 0x29B1);
+}
+
+static void test_crc8(void) {
+  uint8_t crc = Checksum_CRC8(CRC8_INIT, (const uint8_t *)"123456789", 9) ^ CRC8_XOROUT;
+  CHECK(crc == 0x4B);
+}
+
+static void test_cobs(void) {
+  const uint8_t src[] = {0x11, 0x22, 0x00, 0x33};
+  const uint8_t expected[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  uint8_t out[8];
+
+  CHECK(Telemetry_COBSEncode(src, sizeof(src), out) == sizeof(expected));
+  CHECK(memcmp(out, expected, sizeof(expected)) == 0);
+}
+
+static uint16_t cobsDecode(const uint8_t *src, uint16_t size, uint8_t *dst) {
+  uint16_t in = 0, out = 0;
+  while (in < size) {
+    uint8_t code = src[in++];
+    for (uint8_t i = 1; i < code; i++) dst[out++] = src[in++];
+    if (code != 0xFF && in < size) dst[out++] = 0;
+  }
+  return out;
+}
+
+static void test_telemetry_binary_frame(void) {
+  uint8_t payload[SLAVES_NO * IR_BUFFER_SIZE];
+  uint8_t decoded[64];
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  for (int i = 0; i < (int)sizeof(payload); i++) payload[i] = (uint8_t)(i * 7);
+
+  // The header carries the frame's own sweep number and start time
+  IR_Frame ir = {.timestamp = 0x89ABCDEF, .seq = 0x1234};
+  fake_SetTick(0x5678);
+
+  Telemetry_SetMode(TELEMETRY_BINARY);
+  CHECK(Telemetry_SendIRFrame(&ir, payload, sizeof(payload), 5, 0x0321) == HAL_OK);
+  fake_UART_Drain(&uart);
+  Telemetry_SetMode(TELEMETRY_ASCII);
+
+  const uint8_t *wire = fake_UART_Output(&size);
+  CHECK(size > 0 && wire[size - 1] == 0x00);
+  for (uint32_t i = 0; i + 1 < size; i++) CHECK(wire[i] != 0x00);
+
+  uint16_t len = cobsDecode(wire, size - 1, decoded);
+  CHECK(len == TELEMETRY_HEADER_SIZE + sizeof(payload) + 2);
+  CHECK(decoded[0] == TELEMETRY_TYPE_IR);
+  CHECK(decoded[1] == 0x34);
+  CHECK(decoded[2] == 0xEF && decoded[3] == 0xCD && decoded[4] == 0xAB && decoded[5] == 0x89);
+  CHECK(decoded[6] == 5);
+  CHECK(decoded[7] == 0x21 && decoded[8] == 0x03);
+  CHECK(memcmp(&decoded[TELEMETRY_HEADER_SIZE], payload, sizeof(payload)) == 0);
+
+  uint16_t crc = Checksum_CRC16(CRC16_INIT, decoded, len - 2);
+  CHECK(decoded[len - 2] == (crc & 0xFF) && decoded[len - 1] == (crc >> 8));
+}
+
+static void test_ascii_output(void) {
+  uint8_t payload[4] = {0x01, 0x00, 0xE8, 0x03};
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  CHECK(ParseAndDisplayIRData(payload, sizeof(payload)) == HAL_OK);
+  fake_UART_Drain(&uart);
+
+  const uint8_t *wire = fake_UART_Output(&size);
+  const char *expected = "Decimal: 1 1000 \r\n";
+  CHECK(size == strlen(expected));
+  CHECK(memcmp(wire, expected, size) == 0);
+}
+
+static void test_uart_overflow_is_counted(void) {
+  uint8_t chunk[100];
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  memset(chunk, 'x', sizeof(chunk));
+
+  // Nothing drains, so the ring fills up and later writes are dropped whole
+  int accepted = 0;
+  for (int i = 0; i < 10; i++) {
+    if (dataUart_Write(chunk, sizeof(chunk)) == HAL_OK) accepted++;
+  }
+  CHECK(accepted == (DATA_UART_TX_BUFFER_SIZE - 1) / (int)sizeof(chunk));
+  CHECK(dataUart_GetDroppedBytes() == (uint32_t)(10 - accepted) * sizeof(chunk));
+
+  fake_UART_Drain(&uart);
+  fake_UART_Output(&size);
+  CHECK(size == (uint32_t)accepted * sizeof(chunk));
+  CHECK(dataUart_TxPending() == 0);
+}
+
+static void test_led_frame_pulse(void) {
+  setUp(&bus1, &bus2);
+  LED_SetPattern(LED_PATTERN_FRAME);
+  LED_Tick();
+  CHECK(!fake_LED_IsOn());
+
+  LED_FrameEvent();
+  LED_Tick();
+  CHECK(fake_LED_IsOn());
+  for (int i = 0; i < 20; i++) LED_Tick();
+  CHECK(!fake_LED_IsOn());
+  LED_SetPattern(LED_PATTERN_OFF);
+}
+
+// Rising edges over the next `ms` LED ticks
+static int ledBlinks(int ms) {
+  int blinks = 0;
+  uint8_t was = fake_LED_IsOn();
+  for (int i = 0; i < ms; i++) {
+    LED_Tick();
+    if (fake_LED_IsOn() && !was) blinks++;
+    was = fake_LED_IsOn();
+  }
+  return blinks;
+}
+
+static void test_led_error_code(void) {
+  setUp(&bus1, &bus2);
+  LED_SetPattern(LED_PATTERN_FRAME);
+  LED_FrameEvent();
+  LED_SetErrorCode(3);
+  CHECK(ledBlinks(3 * 400 + 1200) == 3);  // overrides the frame pulse
+
+  // Codes past the countable range are clamped, not wrapped
+  LED_SetErrorCode(200);
+  CHECK(ledBlinks(LED_ERROR_MAX_CODE * 400 + 1200) == LED_ERROR_MAX_CODE);
+
+  LED_SetErrorCode(0);
+  LED_FrameEvent();
+  LED_Tick();
+  CHECK(fake_LED_IsOn());  // back to the frame pulse
+  LED_SetPattern(LED_PATTERN_OFF);
+  LED_Tick();
+}
+
+static void test_led_bus_fault_and_ball(void) {
+  uint8_t a[IR_BUFFER_SIZE], b[IR_BUFFER_SIZE];
+  uint16_t eyes[EYE_NUM] = {0, 0, 0, IR_BALL_THRESHOLD + 1, 0, 0, 0};
+
+  setUp(&bus1, &bus2);
+  makePayload(a, 1489, eyes);
+  memset(b, 0, sizeof(b));
+
+  // Arbitration lost: two blinks until a full sweep gets through
+  LED_SetPattern(LED_PATTERN_FRAME);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Fail(&bus1, HAL_I2C_ERROR_ARLO);
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  IR_Service();
+  CHECK(ledBlinks(2 * 400 + 1200) == IR_FAULT_ARBITRATION);
+  fake_SetTick(1);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, b, sizeof(b));
+  LED_FrameEvent();
+  CHECK(ledBlinks(500) == 1);  // just the frame pulse
+
+  // Strongest eye above the threshold: solid on
+  CHECK(IR_AcquireFrame() == 1);
+  LED_FrameEvent();
+  updateValues();
+  CHECK(ledBlinks(LED_IDLE_MS - 1) == 1);
+  CHECK(fake_LED_IsOn());
+
+  // No frames for LED_IDLE_MS: heartbeat, two blinks a second
+  CHECK(ledBlinks(100) == 0);
+  CHECK(!fake_LED_IsOn());
+  CHECK(ledBlinks(1000) == 2);
+  LED_FrameEvent();
+  LED_Tick();
+  CHECK(fake_LED_IsOn());
+  LED_SetPattern(LED_PATTERN_OFF);
+  LED_Tick();
+}
+
+static void test_uart_rx_commands(void) {
+  setUp(&bus1, &bus2);
+  CHECK(dataUart_ReadByte() < 0);
+  CHECK(dataUart_StartRx() == HAL_OK);
+
+  // The callback re-arms the receive for the next byte
+  CHECK(fake_UART_Receive(&uart, 'p'));
+  CHECK(fake_UART_Receive(&uart, 'r'));
+  CHECK(dataUart_ReadByte() == 'p');
+  CHECK(dataUart_ReadByte() == 'r');
+  CHECK(dataUart_ReadByte() < 0);
+}
+
+static void test_profile_stats_and_dump(void) {
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  Profile_Reset();
+  Profile_Record(PROFILE_UPDATE_VALUES, 100);
+  Profile_Record(PROFILE_UPDATE_VALUES, 300);
+  Profile_Record(PROFILE_UPDATE_VALUES, 5);
+
+  const Profile_Stats *s = Profile_Get(PROFILE_UPDATE_VALUES);
+  CHECK(s->count == 3);
+  CHECK(s->min == 5);
+  CHECK(s->max == 300);
+  CHECK(s->sum == 405);
+  CHECK(s->hist[0] == 1);  // 5
+  CHECK(s->hist[2] == 1);  // 100 in [64, 128)
+  CHECK(s->hist[4] == 1);  // 300 in [256, 512)
+
+  // One line per region, each written only once it fits
+  Profile_RequestDump();
+  for (int i = 0; i < PROFILE_REGIONS + 2; i++) {
+    Profile_Poll();
+    fake_UART_Drain(&uart);
+  }
+  const uint8_t *wire = fake_UART_Output(&size);
+  char text[1024] = {0};
+  int lines = 0;
+  for (uint32_t i = 0; i < size && i < sizeof(text) - 1; i++) {
+    text[i] = wire[i];
+    if (wire[i] == '\n') lines++;
+  }
+  CHECK(lines == PROFILE_REGIONS);
+  CHECK(strstr(text, "prof update n=3 min=5 mean=135 max=300 h=1,0,1,0,1,") != NULL);
+
+  Profile_Reset();
+  CHECK(Profile_Get(PROFILE_UPDATE_VALUES)->count == 0);
+}
+
+static void test_frame_latency_stages(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  Latency_Reset();
+
+  // Start just before the µs clock wraps, deltas must still come out right
+  fake_SetUs(0xFFFFFFC0u);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_AddUs(100);
+  fake_I2C_Complete(&bus1, a, sizeof(a));
+  fake_I2C_Complete(&bus2, a, sizeof(a));
+
+  // Time asleep in WFI counts too, CYCCNT would have stopped
+  fake_SetSleep(72 * 50);
+  Idle_Sleep();
+  CHECK(IR_AcquireFrame() == 1);
+  uint32_t processed = Latency_Now();
+  fake_AddUs(20);
+  Latency_Record(IR_CurrentFrame(), processed, Latency_Now());
+
+  CHECK(Latency_Get(LATENCY_DMA)->max == 100);
+  CHECK(Latency_Get(LATENCY_PROCESS)->max == 50);
+  CHECK(Latency_Get(LATENCY_UART)->max == 20);
+  CHECK(Latency_Get(LATENCY_TOTAL)->max == 170);
+  CHECK(Latency_Get(LATENCY_TOTAL)->hist[7] == 1);  // 170 in [128, 256)
+
+  Latency_RequestReport();
+  for (int i = 0; i < LATENCY_STAGES; i++) {
+    Latency_Poll();
+    fake_UART_Drain(&uart);
+  }
+  const uint8_t *wire = fake_UART_Output(&size);
+  char text[1024] = {0};
+  memcpy(text, wire, size < sizeof(text) - 1 ? size : sizeof(text) - 1);
+  CHECK(strstr(text, "lat dma n=1 min=100 mean=100 max=100 us h=0,0,0,0,0,0,1,") != NULL);
+  CHECK(strstr(text, "lat total n=1 min=170 mean=170 max=170 us") != NULL);
+}
+
+static void test_pipeline_occupancy(void) {
+  uint8_t a[IR_BUFFER_SIZE] = {0};
+  uint8_t fill[DATA_UART_TX_BUFFER_SIZE - 64] = {0};
+  Pipeline_Stats s;
+
+  setUp(&bus1, &bus2);
+  fake_SetUs(1000);
+  Pipeline_Init();
+
+  // Two frames queued: acquire took 300 µs for each sweep
+  for (int n = 0; n < 2; n++) {
+    CHECK(IR_StartSweep() == HAL_OK);
+    fake_AddUs(300);
+    fake_I2C_Complete(&bus1, a, sizeof(a));
+    fake_I2C_Complete(&bus2, a, sizeof(a));
+    fake_AddUs(200);
+  }
+
+  CHECK(Pipeline_CanProcess() && IR_AcquireFrame());
+  CHECK(IR_QueueDepth() == 2);
+  Pipeline_Processed(IR_CurrentFrame(), Timebase_Us(), Timebase_Us() + 50);
+  fake_AddUs(50);
+
+  // Emit: the UART is busy for 400 µs with one chunk, the core asleep meanwhile
+  dataUart_Write(fill, 10);
+  fake_SetSleep(72 * 400);
+  Idle_Sleep();
+  fake_UART_Complete(&uart);
+
+  // A full TX ring holds the next frame back in the IR queue
+  dataUart_Write(fill, sizeof(fill));
+  CHECK(!Pipeline_CanProcess());
+  CHECK(IR_QueueDepth() == 2);
+  CHECK(!Pipeline_Resume());  // TX completion, still no room
+
+  Pipeline_GetStats(&s);
+  CHECK(s.frames == 1 && s.stalls == 1 && s.queueMax == 2);
+  CHECK(s.busyUs[PIPE_ACQUIRE] == 300);
+  CHECK(s.busyUs[PIPE_PROCESS] == 50);
+  CHECK(s.busyUs[PIPE_EMIT] == 400);
+  CHECK(s.windowUs == 1450);
+
+  // The TX completion that frees the space resumes the frame task once
+  fake_UART_Drain(&uart);
+  fake_UART_ClearOutput();
+  CHECK(Pipeline_Resume());
+  CHECK(!Pipeline_Resume());
+  CHECK(Pipeline_CanProcess() && IR_AcquireFrame());
+  Pipeline_Processed(IR_CurrentFrame(), Timebase_Us(), Timebase_Us());
+  Pipeline_GetStats(&s);
+  CHECK(s.frames == 2 && s.busyUs[PIPE_ACQUIRE] == 600);
+
+  uint32_t size;
+  CHECK(Pipeline_Report() == HAL_OK);
+  fake_UART_Drain(&uart);
+  const uint8_t *wire = fake_UART_Output(&size);
+  char text[256] = {0};
+  memcpy(text, wire, size < sizeof(text) - 1 ? size : sizeof(text) - 1);
+  CHECK(strstr(text, "pipe acq ") != NULL && strstr(text, "frames 2 stall 1 qmax 2") != NULL);
+  Pipeline_GetStats(&s);
+  CHECK(s.frames == 0);
+}
+
+static char schedTrace[32];
+static int schedTraceLen;
+
+static void schedHigh(Sched_Event event) {
+  schedTrace[schedTraceLen++] = 'H';
+  fake_DWT.CYCCNT += 700;
+}
+
+static void schedLow(Sched_Event event) {
+  schedTrace[schedTraceLen++] = (event == SCHED_EV_TICK) ? 't' : 'l';
+  fake_DWT.CYCCNT += 100;
+  // Posted from inside a task: waits for this run to finish, then goes first
+  if (event == SCHED_EV_UART_RX) Sched_Post(0, SCHED_EV_FRAME_READY);
+}
+
+static void test_scheduler_priorities(void) {
+  Sched_TaskStats s;
+
+  setUp(&bus1, &bus2);
+  Sched_Init();
+  Sched_AddTask(0, "high", schedHigh, 0);
+  Sched_AddTask(3, "low", schedLow, 2);
+  schedTraceLen = 0;
+
+  CHECK(Sched_Post(3, SCHED_EV_UART_RX));
+  CHECK(fake_SCB.ICSR & SCB_ICSR_PENDSVSET_Msk);
+  CHECK(Sched_Post(3, SCHED_EV_UART_RX));  // already queued, coalesced
+  CHECK(Sched_Post(3, SCHED_EV_I2C_ERROR));
+  CHECK(Sched_Post(0, SCHED_EV_FRAME_READY));
+  CHECK(!Sched_Post(5, SCHED_EV_TICK));     // no task there
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 4 && memcmp(schedTrace, "HlHl", 4) == 0);
+
+  // Tick every 2 ms for the low task only
+  schedTraceLen = 0;
+  fake_SetTick(1);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 0);
+  fake_SetTick(2);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 1 && schedTrace[0] == 't');
+
+  // SysTick held off for 7 ms: one tick, not a burst, then the period restarts
+  schedTraceLen = 0;
+  fake_SetTick(9);
+  Sched_Tick();
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 1);
+  fake_SetTick(10);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 1);
+  fake_SetTick(11);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 2);
+
+  // A queue that fills up counts what it loses
+  for (int ev = 0; ev < SCHED_QUEUE_SIZE + 2; ev++) Sched_Post(3, (Sched_Event)(10 + ev));
+  Sched_GetStats(3, &s);
+  CHECK(s.dropped == 3);
+  Sched_Dispatch();
+
+  Sched_GetStats(0, &s);
+  CHECK(s.runs == 2 && s.wcet == 700);
+  Sched_GetStats(3, &s);
+  CHECK(s.runs == 5 + SCHED_QUEUE_SIZE - 1 && s.wcet == 100);
+
+  uint32_t size;
+  CHECK(Sched_Report() == HAL_OK);
+  fake_UART_Drain(&uart);
+  const uint8_t *wire = fake_UART_Output(&size);
+  char text[256] = {0};
+  memcpy(text, wire, size < sizeof(text) - 1 ? size : sizeof(text) - 1);
+  CHECK(strstr(text, "task 0 high runs 2 wcet 9 us drop 0") != NULL);
+  CHECK(strstr(text, "task 3 low runs 12 wcet 1 us drop 3") != NULL);
+}
+
+static void test_scheduler_set_tick(void) {
+  setUp(&bus1, &bus2);
+  Sched_Init();
+  Sched_AddTask(3, "low", schedLow, 0);
+  schedTraceLen = 0;
+
+  // Event-only task: no tick until one is set
+  fake_SetTick(5);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 0);
+
+  // The period counts from the call, setting the same one again keeps its phase
+  Sched_SetTick(3, 2);
+  fake_SetTick(6);
+  Sched_SetTick(3, 2);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 0);
+  fake_SetTick(7);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 1 && schedTrace[0] == 't');
+
+  // A new period starts over, 0 stops the tick
+  Sched_SetTick(3, 10);
+  fake_SetTick(16);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 1);
+  fake_SetTick(17);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 2);
+  Sched_SetTick(3, 0);
+  fake_SetTick(40);
+  Sched_Tick();
+  Sched_Dispatch();
+  CHECK(schedTraceLen == 2 && fake_PRIMASK == 0);
+}
+
+static void test_idle_cpu_load(void) {
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  Idle_Init();
+  uint32_t t0 = HAL_GetTick();
+
+  // 3 x 0.5 ms asleep, the third one across a SysTick reload
+  fake_SetSleep(36000);
+  for (int i = 0; i < 3; i++) Idle_Sleep();
+  CHECK(HAL_GetTick() - t0 == 1);
+  CHECK(fake_PRIMASK == 0);
+
+  // 1.5 ms idle out of 4 ms
+  fake_SetTick(4);
+  CHECK(Idle_GetLoad() == 625);
+
+  CHECK(Idle_Report() == HAL_OK);
+  fake_UART_Drain(&uart);
+  const uint8_t *wire = fake_UART_Output(&size);
+  CHECK(size == strlen("cpu load 62.5%\r\n") && memcmp(wire, "cpu load 62.5%", 14) == 0);
+
+  // New window after the report, fully busy
+  fake_SetTick(6);
+  CHECK(Idle_GetLoad() == 1000);
+}
+
+static void test_timebase_us_clock(void) {
+  uint8_t payload[IR_BUFFER_SIZE] = {0};
+
+  setUp(&bus1, &bus2);
+
+  // TIM1 holds the high half, TIM4 the low half
+  fake_SetUs(0x0001F4A3);
+  CHECK(fake_TIM1.CNT == 1 && fake_TIM4.CNT == 0xF4A3);
+  CHECK(Timebase_Us() == 0x0001F4A3);
+
+  // Frames carry the µs time their sweep started
+  fake_SetUs(123457);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_SetUs(124001);
+  fake_I2C_Complete(&bus1, payload, sizeof(payload));
+  fake_I2C_Complete(&bus2, payload, sizeof(payload));
+  CHECK(IR_AcquireFrame() == 1);
+  CHECK(IR_CurrentFrame()->timestamp == 123457);
+
+  // Deltas stay right across the 32-bit wrap
+  fake_SetUs(0xFFFFFF00u);
+  CHECK(IR_StartSweep() == HAL_OK);
+  fake_I2C_Complete(&bus1, payload, sizeof(payload));
+  fake_I2C_Complete(&bus2, payload, sizeof(payload));
+  CHECK(IR_AcquireFrame() == 1);
+  fake_SetUs(0x100);
+  CHECK(Timebase_Us() - IR_CurrentFrame()->timestamp == 0x200);
+}
+
+static void test_timebase_hal_tick(void) {
+  setUp(&bus1, &bus2);
+
+  // fake_Reset ran HAL_InitTick: 1 MHz from the 72 MHz APB1 timer clock, TIM1 counts TIM4 wraps
+  CHECK(fake_TIM4.PSC == 71 && fake_TIM4.ARR == 0xFFFF && (fake_TIM4.CR1 & TIM_CR1_CEN));
+  CHECK((fake_TIM1.SMCR & TIM_SMCR_SMS) == TIM_SMCR_SMS && (fake_TIM1.CR1 & TIM_CR1_CEN));
+  CHECK(fake_SysTick.LOAD == 72000 - 1 && fake_NVIC_Priority(SysTick_IRQn) == TICK_INT_PRIORITY);
+
+  // Whole ms fold in, the remainder carries to the next read
+  uint32_t t0 = HAL_GetTick();
+  fake_SetUs(1500);
+  CHECK(HAL_GetTick() - t0 == 1);
+  fake_SetUs(2499);
+  CHECK(HAL_GetTick() - t0 == 2);
+  fake_SetUs(2500);
+  HAL_IncTick();
+  CHECK(HAL_GetTick() - t0 == 2);
+  fake_SetUs(3000);
+  CHECK(HAL_GetTick() - t0 == 3);
+
+  // SysTick keeps folding across the 32-bit µs wrap (90 min > 71.6), no ms lost or gained
+  uint32_t us = 3000;
+  for (int i = 0; i < 3; i++) {
+    us += 1800000000u;  // 30 min between SysTicks, well inside one wrap
+    fake_SetUs(us);
+    HAL_IncTick();
+  }
+  CHECK(HAL_GetTick() - t0 == 3 + 3 * 1800000);
+
+  // A second HAL_InitTick (clock change) restarts the µs clock, not the ms count
+  uint32_t t1 = HAL_GetTick();
+  CHECK(HAL_InitTick(TICK_INT_PRIORITY) == HAL_OK);
+  CHECK(Timebase_Us() == 0 && HAL_GetTick() == t1);
+  fake_SetTick(5);
+  CHECK(HAL_GetTick() - t1 == 5);
+  HAL_Delay(3);
+  CHECK(HAL_GetTick() - t1 == 8);
+}
+
+// Fire one probe update with the counter at ticks when the handler gets in
+static void probeFire(uint32_t ticks) {
+  fake_TIM3.SR |= TIM_SR_UIF;
+  fake_TIM3.CNT = ticks;
+  Irq_ProbeHandler();
+}
+
+static void test_irq_latency_probe(void) {
+  Irq_LatencyStats s;
+  uint32_t size;
+
+  setUp(&bus1, &bus2);
+  Irq_ProbeInit();
+  CHECK(fake_TIM3.PSC == 8);  // 72 MHz timer clock down to 8 MHz
+  CHECK(fake_TIM3.ARR == IRQ_PROBE_PERIOD_US * IRQ_PROBE_MHZ - 1);
+  CHECK((fake_TIM3.CR1 & TIM_CR1_CEN) && (fake_TIM3.DIER & TIM_DIER_UIE));
+  CHECK(fake_NVIC_Priority(IRQ_PROBE_IRQn) == IRQ_PRIO_BUS);
+
+  // One period per level, the probe walks bus -> tasks and wraps around
+  for (int i = 0; i < IRQ_LEVELS; i++) probeFire(10 * (i + 1));
+  CHECK(fake_NVIC_Priority(IRQ_PROBE_IRQn) == IRQ_PRIO_BUS);
+  probeFire(30);
+  CHECK(fake_NVIC_Priority(IRQ_PROBE_IRQn) == IRQ_PRIO_DMA);
+  CHECK(!(fake_TIM3.SR & TIM_SR_UIF));
+
+  // No update pending: not a probe period, nothing recorded
+  fake_TIM3.CNT = 500;
+  Irq_ProbeHandler();
+  CHECK(fake_NVIC_Priority(IRQ_PROBE_IRQn) == IRQ_PRIO_DMA);
+
+  Irq_GetLatency(IRQ_LEVEL_BUS, &s);
+  CHECK(s.count == 2 && s.maxTicks == 30 && s.sumTicks == 40);
+  Irq_GetLatency(IRQ_LEVEL_TASKS, &s);
+  CHECK(s.count == 1 && s.maxTicks == 60);
+
+  CHECK(Irq_Report() == HAL_OK);
+  fake_UART_Drain(&uart);
+  const uint8_t *wire = fake_UART_Output(&size);
+  const char *first = "irq 0 bus max 3750 ns mean 2500 ns n 2\r\n";
+  CHECK(size > strlen(first) && memcmp(wire, first, strlen(first)) == 0);
+
+  Irq_ResetLatency();
+  Irq_GetLatency(IRQ_LEVEL_BUS, &s);
+  CHECK(s.count == 0 && s.maxTicks == 0);
+}
+
+int main(void) {
+  struct {
+    const char *name;
+    void (*run)(void);
+  } tests[] = {
+    {"combine_data", test_combine_data},
+    {"sweep_two_buses", test_sweep_two_buses},
+    {"sweep_shared_bus", test_sweep_shared_bus},
+    {"sweep_failed_slave_is_dropped", test_sweep_failed_slave_is_dropped},
+    {"bus_error_recovery_and_backoff", test_bus_error_recovery_and_backoff},
+    {"recovery_spares_other_bus", test_recovery_spares_other_bus},
+    {"hotplug_detach_and_readmit", test_hotplug_detach_and_readmit},
+    {"claimed_bus_holds_sweeps", test_claimed_bus_holds_sweeps},
+    {"data_ready_trigger", test_data_ready_trigger},
+    {"frame_check_drops_bad_frames", test_frame_check_drops_bad_frames},
+    {"roi_window_reads", test_roi_window_reads},
+    {"batch_reads_unpack_samples", test_batch_reads_unpack_samples},
+    {"save_data_one_frame", test_save_data_one_frame},
+    {"queue_overwrite_accounting", test_queue_overwrite_accounting},
+    {"update_values_and_bearing", test_update_values_and_bearing},
+    {"bearing_atan2", test_bearing_atan2},
+    {"adc_to_mv", test_adc_to_mv},
+    {"crc16", test_crc16},
+    {"crc8", test_crc8},
+    {"cobs", test_cobs},
+    {"telemetry_binary_frame", test_telemetry_binary_frame},
+    {"ascii_output", test_ascii_output},
+    {"uart_overflow_is_counted", test_uart_overflow_is_counted},
+    {"led_frame_pulse", test_led_frame_pulse},
+    {"led_error_code", test_led_error_code},
+    {"led_bus_fault_and_ball", test_led_bus_fault_and_ball},
+    {"uart_rx_commands", test_uart_rx_commands},
+    {"profile_stats_and_dump", test_profile_stats_and_dump},
+    {"frame_latency_stages", test_frame_latency_stages},
+    {"pipeline_occupancy", test_pipeline_occupancy},
+    {"scheduler_priorities", test_scheduler_priorities},
+    {"scheduler_set_tick", test_scheduler_set_tick},
+    {"idle_cpu_load", test_idle_cpu_load},
+    {"irq_latency_probe", test_irq_latency_probe},
+    {"timebase_us_clock", test_timebase_us_clock},
+    {"timebase_hal_tick", test_timebase_hal_tick},
+  };
+
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    int before = failures;
+    tests[i].run();
+    printf("%s %s\n", failures == before ? "PASS" : "FAIL", tests[i].name);
+  }
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+# Fail the build if any of OBJECTS references a soft-float routine.
+# Usage: cmake -DNM=<nm> -DOBJECTS=<a.o;b.o> -P check_no_float.cmake
+
+set(FLOAT_SYMBOLS "__aeabi_[fd][a-z0-9]+|__aeabi_[iul]+2[fd]|__(add|sub|mul|div|neg|fix|float|extend|trunc|cmp|eq|ne|lt|le|gt|ge|unord)[a-z]*[sd]f[0-9]?")
+
+foreach(obj IN LISTS OBJECTS)
+    execute_process(
+        COMMAND ${NM} -u ${obj}
+        OUTPUT_VARIABLE undefined
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${obj}")
+    endif()
+    string(REGEX MATCHALL "(${FLOAT_SYMBOLS})" hits "${undefined}")
+    if(hits)
+        list(REMOVE_DUPLICATES hits)
+        get_filename_component(name ${obj} NAME)
+        message(FATAL_ERROR "${name} pulls in soft-float routines: ${hits}")
+    endif()
+endforeach()
@@ -13,6 +13,7 @@ set(CMAKE_CXX_COMPILER              ${TOOLCHAIN_PREFIX}clang++)
 set(CMAKE_LINKER                    ${TOOLCHAIN_PREFIX}clang)
 set(CMAKE_OBJCOPY                   ${TOOLCHAIN_PREFIX}objcopy)
 set(CMAKE_SIZE                      ${TOOLCHAIN_PREFIX}size)
+set(CMAKE_NM                        ${TOOLCHAIN_PREFIX}nm)
 
 set(CMAKE_EXECUTABLE_SUFFIX_ASM     ".elf")
 set(CMAKE_EXECUTABLE_SUFFIX_C       ".elf")